@@ -1,16 +1,25 @@
 #include "aiv_plugin.h"
 
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <string>
 #include <vector>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <algorithm>
+#include <type_traits>
 
 #include <grpcpp/grpcpp.h>
 #include <vision.grpc.pb.h>
@@ -18,6 +27,13 @@
 #include <turbojpeg.h>
 #include <libyuv.h>
 
+#include "box_tracker.h"
+#include "result_unpack.h"
+
+#if defined(AIV_HAVE_OPENH264)
+#include <wels/codec_api.h>
+#endif
+
 #if defined(__ANDROID__)
 #include <android/log.h>
 #include <camera/NdkCameraManager.h>
@@ -39,45 +55,265 @@ static std::string   g_target;
 static std::string   g_stream_base  = "default";
 static std::atomic<int> g_running{0};
 static std::atomic<int> g_connected{0};
-static float         g_score_thresh = 0.0f;
-static AIV_JpegConfig g_jpeg_cfg{0, 0, 70};
+static std::atomic<int32_t> g_slice_count{1};
+static AIV_VideoConfig g_video_cfg{AIV_CODEC_JPEG, 2000, 30};
+static AIV_BatchConfig g_batch_cfg{1, 256 * 1024, 5000};
+static std::atomic<int32_t> g_color_mode{AIV_COLOR_YUV};
+
+static AIV_TrackerConfig g_tracker_cfg{0.3f, 0.5f, 500000000LL, 200000000LL};
+static std::mutex g_tracker_cfg_mu;
 
 static inline void clamp_jpeg_cfg(AIV_JpegConfig& c) {
   if (c.jpeg_quality < 1)   c.jpeg_quality = 70;
   if (c.jpeg_quality > 100) c.jpeg_quality = 100;
+  if (c.jpeg_width < 0)     c.jpeg_width = 0;
+  if (c.jpeg_height < 0)    c.jpeg_height = 0;
 }
 
-static std::shared_ptr<grpc::Channel> g_channel;
-static std::unique_ptr<vision::Vision::Stub> g_stub;
-static std::unique_ptr<grpc::ClientContext> g_ctx;
-static std::unique_ptr<grpc::ClientReaderWriter<vision::Frame, vision::Result>> g_stream;
-static std::mutex g_stream_mu;
+static inline bool clamp_stream_policy(AIV_StreamPolicy& p) {
+  if (p.drop_policy != AIV_DROP_OLDEST && p.drop_policy != AIV_DROP_NEWEST) return false;
+  if (!(p.max_fps > 0.0f)) p.max_fps = 0.0f;
+  if (p.priority < 1) p.priority = 1;
+  return true;
+}
+
+// Seqlock over a small trivially copyable value. Writers are serialised by a
+// mutex and never wait for readers; a reader copies without locking and
+// retries only if a write overlapped the copy. The value is held in relaxed
+// atomic words so that overlapping copy is not a data race.
+template <class T>
+class SeqlockSnapshot {
+  static_assert(std::is_trivially_copyable<T>::value, "snapshot must be POD");
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+public:
+  explicit SeqlockSnapshot(const T& init) : cur_(init) { store_words(init); }
+
+  T load() const {
+    uint32_t buf[kWords];
+    for (;;) {
+      const uint32_t s0 = seq_.load(std::memory_order_acquire);
+      if (s0 & 1) { std::this_thread::yield(); continue; }
+      for (size_t i = 0; i < kWords; ++i) buf[i] = words_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == s0) break;
+    }
+    T out;
+    std::memcpy(&out, buf, sizeof(T));
+    return out;
+  }
+
+  // Applies fn to a copy of the current value and publishes the result.
+  template <class Fn>
+  T update(Fn&& fn) {
+    std::lock_guard<std::mutex> lk(write_mu_);
+    T next = cur_;
+    fn(next);
+    cur_ = next;
+    const uint32_t s0 = seq_.load(std::memory_order_relaxed);
+    seq_.store(s0 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    store_words(next);
+    seq_.store(s0 + 2, std::memory_order_release);
+    return next;
+  }
+
+private:
+  void store_words(const T& v) {
+    uint32_t buf[kWords] = {};
+    std::memcpy(buf, &v, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) words_[i].store(buf[i], std::memory_order_relaxed);
+  }
+
+  std::mutex write_mu_;
+  T cur_;
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<uint32_t> words_[kWords];
+};
+
+// Everything that may change mid-stream. The hot paths take one snapshot per
+// frame (or result) and every setter publishes a new version.
+static SeqlockSnapshot<AIV_LiveConfig> g_live(AIV_LiveConfig{
+    {0, 0, 70}, 0.0f, {{0.0f, 1, AIV_DROP_OLDEST}, {0.0f, 1, AIV_DROP_OLDEST}}, 1});
+
+static inline int role_index(AIV_CamRole r) { return (r == AIV_CAM_RIGHT) ? 1 : 0; }
+
+static inline void clamp_tracker_cfg(AIV_TrackerConfig& c) {
+  if (c.iou_threshold <= 0.0f || c.iou_threshold > 1.0f) c.iou_threshold = 0.3f;
+  if (c.velocity_smoothing <= 0.0f || c.velocity_smoothing > 1.0f) c.velocity_smoothing = 0.5f;
+  if (c.max_age_ns <= 0)     c.max_age_ns = 500000000LL;
+  if (c.max_predict_ns < 0)  c.max_predict_ns = 200000000LL;
+}
+
+static AIV_TrackerConfig get_tracker_cfg() {
+  std::lock_guard<std::mutex> lk(g_tracker_cfg_mu);
+  return g_tracker_cfg;
+}
+
+// One connection to the server with the streaming call on it and the
+// threads that feed and drain it. Link 0 carries both cameras unless
+// AIV_CONNECTION_PER_STREAM is set, in which case link i carries camera i.
+struct Link {
+  std::shared_ptr<grpc::Channel> channel;
+  std::unique_ptr<vision::Vision::Stub> stub;
+  std::unique_ptr<grpc::ClientContext> ctx;
+  std::unique_ptr<grpc::ClientReaderWriter<vision::Frame, vision::Result>> stream;
+  std::unique_ptr<grpc::ClientReaderWriter<vision::FrameBatch, vision::Result>> batch_stream;
+  std::mutex mu;
+  std::thread send_th, recv_th;
+};
+
+static Link g_links[2];
+static std::atomic<int32_t> g_conn_mode{AIV_CONNECTION_SHARED};
+static int g_link_count = 1; // links the current session runs on
+
+static inline int links_for_mode(int32_t mode) { return (mode == AIV_CONNECTION_PER_STREAM) ? 2 : 1; }
 
 #if defined(__ANDROID__)
 static ACameraManager* g_mgr = nullptr;
 #endif
 
-static bool I420ToJpeg(const uint8_t* i420, int w, int h, int quality, std::vector<uint8_t>& jpeg) {
-  tjhandle hnd = tjInitCompress();
-  if (!hnd) return false;
-  const unsigned char* planes[3] = {
-    (const unsigned char*)i420,
-    (const unsigned char*)(i420 + w * h),
-    (const unsigned char*)(i420 + w * h + ((w + 1) / 2) * ((h + 1) / 2))
+// One compressor per encode thread, created on first use (or by warm-up)
+// rather than for every band.
+static tjhandle tj_compressor() {
+  struct Holder {
+    tjhandle h{nullptr};
+    ~Holder() { if (h) tjDestroy(h); }
   };
-  const int strides[3] = { w, (w + 1) / 2, (w + 1) / 2 };
+  static thread_local Holder holder;
+  if (!holder.h) holder.h = tjInitCompress();
+  return holder.h;
+}
+
+// Encodes rows [y0, y0 + rows) of an I420 image; y0 must be even. With gray
+// the buffer holds only the Y plane and the JPEG has a single component.
+static bool I420RowsToJpeg(const uint8_t* i420, int w, int h, bool gray, int y0, int rows, int quality,
+                           std::vector<uint8_t>& jpeg) {
+  tjhandle hnd = tj_compressor();
+  if (!hnd) return false;
+  const unsigned char* planes[3] = { (const unsigned char*)(i420 + w * y0), nullptr, nullptr };
+  int strides[3] = { w, 0, 0 };
+  if (!gray) {
+    const int uv_w = (w + 1) / 2;
+    const uint8_t* u = i420 + w * h;
+    const uint8_t* v = u + uv_w * ((h + 1) / 2);
+    planes[1] = (const unsigned char*)(u + uv_w * (y0 / 2));
+    planes[2] = (const unsigned char*)(v + uv_w * (y0 / 2));
+    strides[1] = strides[2] = uv_w;
+  }
   unsigned char* out = nullptr;
   unsigned long out_size = 0;
   const int rc = tjCompressFromYUVPlanes(
-    hnd, planes, w, strides, h, TJSAMP_420, &out, &out_size, quality, TJFLAG_FASTDCT
+    hnd, planes, w, strides, rows, gray ? TJSAMP_GRAY : TJSAMP_420, &out, &out_size, quality, TJFLAG_FASTDCT
   );
-  if (rc != 0) { tjDestroy(hnd); return false; }
+  if (rc != 0) { tjFree(out); return false; }
   jpeg.assign(out, out + out_size);
   tjFree(out);
-  tjDestroy(hnd);
   return true;
 }
 
+static bool I420ToJpeg(const uint8_t* i420, int w, int h, bool gray, int quality, std::vector<uint8_t>& jpeg) {
+  return I420RowsToJpeg(i420, w, h, gray, 0, h, quality, jpeg);
+}
+
+#if defined(AIV_HAVE_OPENH264)
+// openh264 in its real-time camera configuration: baseline profile (no
+// B-frames), one slice, one reference frame, no frame skipping.
+class H264Encoder {
+public:
+  ~H264Encoder() { close(); }
+
+  bool open(int w, int h, int fps, const AIV_VideoConfig& vc) {
+    close();
+    if (WelsCreateSVCEncoder(&enc_) != 0 || !enc_) { enc_ = nullptr; return false; }
+    SEncParamExt p;
+    enc_->GetDefaultParams(&p);
+    p.iUsageType = CAMERA_VIDEO_REAL_TIME;
+    p.iPicWidth = w;
+    p.iPicHeight = h;
+    p.iTargetBitrate = vc.bitrate_kbps * 1000;
+    p.iMaxBitrate = vc.bitrate_kbps * 1000;
+    p.iRCMode = RC_BITRATE_MODE;
+    p.fMaxFrameRate = (float)fps;
+    p.iTemporalLayerNum = 1;
+    p.iSpatialLayerNum = 1;
+    p.sSpatialLayers[0].iVideoWidth = w;
+    p.sSpatialLayers[0].iVideoHeight = h;
+    p.sSpatialLayers[0].fFrameRate = (float)fps;
+    p.sSpatialLayers[0].iSpatialBitrate = p.iTargetBitrate;
+    p.sSpatialLayers[0].iMaxSpatialBitrate = p.iMaxBitrate;
+    p.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
+    p.uiIntraPeriod = (unsigned int)vc.keyframe_interval;
+    p.iNumRefFrame = 1;
+    p.eSpsPpsIdStrategy = CONSTANT_ID;
+    p.bPrefixNalAddingCtrl = false;
+    p.iEntropyCodingModeFlag = 0;
+    p.bEnableFrameSkip = false;
+    p.iMultipleThreadIdc = 1;
+    if (enc_->InitializeExt(&p) != cmResultSuccess) { close(); return false; }
+    int fmt = videoFormatI420;
+    enc_->SetOption(ENCODER_OPTION_DATAFORMAT, &fmt);
+    w_ = w; h_ = h; fps_ = fps;
+    return true;
+  }
+
+  void close() {
+    if (!enc_) return;
+    enc_->Uninitialize();
+    WelsDestroySVCEncoder(enc_);
+    enc_ = nullptr;
+    w_ = h_ = fps_ = 0;
+  }
+
+  bool matches(int w, int h) const { return enc_ && w == w_ && h == h_; }
+
+  // Retargets rate control to a new frame rate without a new IDR.
+  bool set_fps(int fps) {
+    if (!enc_) return false;
+    if (fps == fps_) return true;
+    float f = (float)fps;
+    if (enc_->SetOption(ENCODER_OPTION_FRAME_RATE, &f) != cmResultSuccess) return false;
+    fps_ = fps;
+    return true;
+  }
+
+  // Empty `out` means the encoder produced nothing for this picture.
+  bool encode(const uint8_t* i420, uint64_t ts_ns, bool force_idr,
+              std::vector<uint8_t>& out, bool* keyframe) {
+    const int uv_w = (w_ + 1) / 2;
+    SSourcePicture pic{};
+    pic.iColorFormat = videoFormatI420;
+    pic.iPicWidth = w_;
+    pic.iPicHeight = h_;
+    pic.iStride[0] = w_;
+    pic.iStride[1] = pic.iStride[2] = uv_w;
+    pic.pData[0] = const_cast<uint8_t*>(i420);
+    pic.pData[1] = pic.pData[0] + w_ * h_;
+    pic.pData[2] = pic.pData[1] + uv_w * ((h_ + 1) / 2);
+    pic.uiTimeStamp = (long long)(ts_ns / 1000000ULL);
+
+    if (force_idr) enc_->ForceIntraFrame(true);
+    SFrameBSInfo info{};
+    if (enc_->EncodeFrame(&pic, &info) != cmResultSuccess) return false;
+
+    out.clear();
+    if (info.eFrameType == videoFrameTypeSkip) return true;
+    for (int l = 0; l < info.iLayerNum; ++l) {
+      const SLayerBSInfo& layer = info.sLayerInfo[l];
+      size_t len = 0;
+      for (int n = 0; n < layer.iNalCount; ++n) len += (size_t)layer.pNalLengthInByte[n];
+      out.insert(out.end(), layer.pBsBuf, layer.pBsBuf + len);
+    }
+    *keyframe = (info.eFrameType == videoFrameTypeIDR);
+    return true;
+  }
+
+private:
+  ISVCEncoder* enc_{nullptr};
+  int w_{0}, h_{0}, fps_{0};
+};
+#endif
+
 template <typename T>
 class SpscQueue {
 public:
@@ -90,6 +326,7 @@ public:
     size_t n = cap_;
     if (((h + 1) % n) == t) { // full -> drop oldest
       tail_.store((t + 1) % n, std::memory_order_release);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
     }
     buf_[h] = std::move(v);
     head_.store((h + 1) % n, std::memory_order_release);
@@ -106,18 +343,172 @@ public:
   void clear() {
     tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
   }
+  // Drop-newest variant of push: leaves the queue alone when it is full.
+  bool push_if_room(T&& v) {
+    size_t h = head_.load(std::memory_order_relaxed);
+    if (((h + 1) % cap_) == tail_.load(std::memory_order_acquire)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[h] = std::move(v);
+    head_.store((h + 1) % cap_, std::memory_order_release);
+    return true;
+  }
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  // Items push_if_room could still take; exact on the producer side.
+  size_t free_slots() const {
+    size_t h = head_.load(std::memory_order_relaxed);
+    size_t t = tail_.load(std::memory_order_acquire);
+    return cap_ - 1 - (h + cap_ - t) % cap_;
+  }
+  bool full() const {
+    size_t h = head_.load(std::memory_order_acquire);
+    size_t t = tail_.load(std::memory_order_acquire);
+    return ((h + 1) % cap_) == t;
+  }
 private:
   size_t cap_;
   std::vector<T> buf_;
   std::atomic<size_t> head_{0};
   std::atomic<size_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+// NTP-style clock offset/drift between headset and server, fed by the
+// timestamps every Result carries: t0 client send, t1 server receive, t2
+// server send, t3 client receive. Samples with the smallest network delay
+// are the least distorted by queuing, so each one-second bucket keeps only
+// its fastest sample, and the offset-over-time line is fitted through the
+// faster half of the last minute of buckets.
+class ClockSync {
+public:
+  void reset() {
+    std::lock_guard<std::mutex> lk(mu_);
+    n_ = head_ = 0;
+    have_cur_ = have_fit_ = false;
+    slope_ = 0.0;
+  }
+
+  void add(int64_t t0, int64_t t1, int64_t t2, int64_t t3) {
+    const int64_t delay = (t3 - t0) - (t2 - t1);
+    if (delay < 0) return;
+    const Sample smp{t0 + (t3 - t0) / 2, ((t1 - t0) + (t2 - t3)) / 2, delay};
+    std::lock_guard<std::mutex> lk(mu_);
+    if (have_cur_ && smp.t / kBucketNs != cur_.t / kBucketNs) {
+      buckets_[head_] = cur_;
+      head_ = (head_ + 1) % kBuckets;
+      if (n_ < kBuckets) n_++;
+      have_cur_ = false;
+    }
+    if (!have_cur_ || smp.delay < cur_.delay) { cur_ = smp; have_cur_ = true; }
+    fit();
+  }
+
+  // Server clock minus headset clock at headset time t.
+  bool offset_at(int64_t t, int64_t* out) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!have_fit_) return false;
+    *out = off_ref_ + (int64_t)(slope_ * (double)(t - t_ref_) + intercept_);
+    return true;
+  }
+
+  AIV_ClockSync get(int64_t now) {
+    AIV_ClockSync c{};
+    int64_t off = 0;
+    if (offset_at(now, &off)) c.offset_ns = off;
+    std::lock_guard<std::mutex> lk(mu_);
+    c.drift_ppm = slope_ * 1e6;
+    c.min_rtt_ns = min_rtt_;
+    c.samples = (int32_t)(n_ + (have_cur_ ? 1 : 0));
+    return c;
+  }
+
+private:
+  struct Sample { int64_t t; int64_t offset; int64_t delay; };
+  static constexpr size_t  kBuckets = 64;
+  static constexpr int64_t kBucketNs = 1000000000LL;
+
+  void fit() {
+    Sample best[kBuckets + 1];
+    size_t n = 0;
+    for (size_t i = 0; i < n_; ++i) best[n++] = buckets_[i];
+    if (have_cur_) best[n++] = cur_;
+    if (!n) return;
+    const size_t m = std::max<size_t>(1, (n + 1) / 2);
+    std::partial_sort(best, best + m, best + n,
+                      [](const Sample& a, const Sample& b) { return a.delay < b.delay; });
+    min_rtt_ = best[0].delay;
+    t_ref_ = best[0].t;
+    off_ref_ = best[0].offset;
+
+    // Relative to the best sample so the doubles stay small.
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < m; ++i) {
+      const double x = (double)(best[i].t - t_ref_);
+      const double y = (double)(best[i].offset - off_ref_);
+      sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    const double k = (double)m;
+    const double den = k * sxx - sx * sx;
+    if (m >= 4 && den > 0.0) {
+      slope_ = (k * sxy - sx * sy) / den;
+      intercept_ = (sy - slope_ * sx) / k;
+    } else {
+      slope_ = 0.0;
+      intercept_ = sy / k;
+    }
+    have_fit_ = true;
+  }
+
+  std::mutex mu_;
+  Sample buckets_[kBuckets]{};
+  Sample cur_{};
+  size_t n_{0}, head_{0};
+  bool have_cur_{false}, have_fit_{false};
+  int64_t t_ref_{0}, off_ref_{0}, min_rtt_{0};
+  double slope_{0.0}, intercept_{0.0};
+};
+
+static ClockSync g_clock;
+
+// Startup timeline of the current session, in ns since the start call.
+// Each milestone is recorded once; 0 = not reached yet.
+struct StartupTimeline {
+  std::atomic<int64_t> t0{0};
+  std::atomic<int64_t> channel_ready{0}, stream_open{0}, camera_open[2]{{0}, {0}};
+  std::atomic<int64_t> encoder_ready{0}, first_frame{0}, first_send{0}, first_result{0};
+
+  void begin() {
+    for (auto* a : {&channel_ready, &stream_open, &camera_open[0], &camera_open[1],
+                    &encoder_ready, &first_frame, &first_send, &first_result}) a->store(0);
+    t0.store(AIV_GetElapsedRealtimeNanos());
+  }
+
+  void mark(std::atomic<int64_t>& at) {
+    if (at.load(std::memory_order_relaxed)) return;
+    int64_t zero = 0;
+    at.compare_exchange_strong(zero, std::max<int64_t>(1, AIV_GetElapsedRealtimeNanos() - t0.load()));
+  }
+
+  // For milestones that wait on several threads: keeps the latest.
+  void mark_last(std::atomic<int64_t>& at) {
+    const int64_t v = std::max<int64_t>(1, AIV_GetElapsedRealtimeNanos() - t0.load());
+    int64_t cur = at.load();
+    while (cur < v && !at.compare_exchange_weak(cur, v)) {}
+  }
 };
 
+static StartupTimeline g_startup;
+
 struct I420Frame {
   AIV_CamRole role;
   int w{0}, h{0};
   int64_t frame_index{0};
   uint64_t ts_ns{0};
+  bool gray{false};          // AIV_COLOR_GRAY: data is the Y plane alone
   std::vector<uint8_t> data; // size = w*h + (w/2*h/2)*2
 };
 
@@ -126,9 +517,15 @@ struct EncodedPacket {
   int w{0}, h{0};
   int64_t frame_index{0};
   uint64_t ts_ns{0};
-  std::vector<uint8_t> jpeg;
+  std::vector<uint8_t> data; // JPEG, H.264 access unit or raw planes
+  int format{vision::IMAGE_FORMAT_JPEG};
+  bool keyframe{true};
   std::string camera_id;
   std::string stream_id;
+  int slice_index{0};
+  int slice_count{1};
+  int slice_y{0};
+  uint32_t config_version{0};
 };
 
 struct CamContext {
@@ -136,6 +533,13 @@ struct CamContext {
   std::string cam_id;
   AIV_CaptureConfig cfg{0,0,0};
   std::atomic<int64_t> idx{0};
+  std::atomic<int32_t> result_encoding{AIV_RESULT_DETECTIONS};
+
+  int64_t gate_next_ns{0};  // admit_frame state, capture thread only
+  int64_t gate_last_ns{0};
+
+  int64_t send_frame{-1};   // sliced frame being sent and its next band, send thread only
+  int send_slice{0};
 
   std::unique_ptr<SpscQueue<I420Frame>> raw_q;   // capture -> encode
   std::unique_ptr<SpscQueue<EncodedPacket>> enc_q; // encode -> send
@@ -143,6 +547,12 @@ struct CamContext {
   std::thread encode_th;
   std::atomic<int> encode_running{0};
 
+  BoxTracker tracker;
+
+#if defined(AIV_HAVE_OPENH264)
+  H264Encoder h264;
+#endif
+
 #if defined(__ANDROID__)
   ACameraDevice* device{nullptr};
   AImageReader* reader{nullptr};
@@ -151,6 +561,8 @@ struct CamContext {
   ACaptureSessionOutput* output{nullptr};
   ACameraOutputTarget* target{nullptr};
   ACameraCaptureSession* session{nullptr};
+#else
+  std::thread synth_th;
 #endif
 };
 
@@ -159,9 +571,417 @@ static CamContext g_right;
 
 static inline const char* role_suffix(AIV_CamRole r) { return (r==AIV_CAM_LEFT) ? "left" : "right"; }
 
+template <class T>
+static void enqueue(SpscQueue<T>* q, T&& v, int32_t drop_policy) {
+  if (!q) return;
+  if (drop_policy == AIV_DROP_NEWEST) q->push_if_room(std::move(v));
+  else q->push(std::move(v));
+}
+
+// Decimates a camera to its policy's max_fps before any conversion or
+// encoding happens. A frame passes once it is within half a capture interval
+// of the next slot, so capture jitter does not push it to the next frame.
+static bool admit_frame(CamContext* cc, int64_t ts_ns, float fps) {
+  const int64_t interval = cc->gate_last_ns ? ts_ns - cc->gate_last_ns : 0;
+  cc->gate_last_ns = ts_ns;
+  if (fps <= 0.0f) return true;
+
+  const int64_t period = (int64_t)(1e9 / fps);
+  if (cc->gate_next_ns && ts_ns + std::max<int64_t>(interval, 0) / 2 < cc->gate_next_ns) return false;
+  // Keep the long-run rate exact, but resynchronise after a stall.
+  cc->gate_next_ns = (cc->gate_next_ns && ts_ns - cc->gate_next_ns < period)
+                       ? cc->gate_next_ns + period : ts_ns + period;
+  return true;
+}
+
+static CamContext* cam_for_stream_id(const std::string& stream_id) {
+  const std::string right = std::string("_") + role_suffix(AIV_CAM_RIGHT);
+  if (stream_id.size() >= right.size() &&
+      stream_id.compare(stream_id.size() - right.size(), right.size(), right) == 0) return &g_right;
+  return &g_left;
+}
+
+// ---------------------------------------------------------------------------
+// Session log
+//
+// <path>      : LogFileHeader, then 8-byte aligned records
+//               (LogRecordHeader + stream_id + camera_id + payload).
+//               Packets carry the JPEG, results the serialized vision::Result.
+// <path>.idx  : LogFileHeader, then one LogIndexEntry per
+//               (frame_index * 2 + role) holding record offsets, 0 = absent.
+// Both files are grown with ftruncate and written through mmap.
+// ---------------------------------------------------------------------------
+static constexpr uint32_t kLogMagic      = 0x474c5641; // "AVLG"
+static constexpr uint32_t kLogIndexMagic = 0x58495641; // "AVIX"
+static constexpr uint32_t kLogVersion    = 3;
+
+enum : uint32_t { kLogRecPacket = 1, kLogRecResult = 2 };
+
+struct LogFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t reserved;
+};
+
+struct LogRecordHeader {
+  uint32_t type;
+  int32_t  role;
+  int64_t  frame_index;
+  uint64_t ts_ns;     // capture time
+  int64_t  wall_ns;   // send / receive time (AIV_GetElapsedRealtimeNanos)
+  int32_t  w, h;
+  uint32_t stream_id_len;
+  uint32_t camera_id_len;
+  uint64_t payload_len;
+  uint16_t slice_index;
+  uint16_t slice_count;
+  uint32_t slice_y;
+  uint32_t format;    // vision::ImageFormat
+  uint32_t keyframe;
+};
+static_assert(sizeof(LogRecordHeader) == 72, "LogRecordHeader layout");
+
+struct LogIndexEntry {
+  uint64_t packet_off;
+  uint64_t result_off;
+};
+
+static inline uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+class MappedFile {
+public:
+  ~MappedFile() { close(); }
+
+  bool create(const std::string& path, size_t initial) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+    writable_ = true;
+    return reserve(initial);
+  }
+
+  bool open_ro(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+    struct stat st{};
+    if (fstat(fd_, &st) != 0 || st.st_size <= 0) { close(); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) { close(); return false; }
+    data_ = (uint8_t*)p;
+    cap_ = (size_t)st.st_size;
+    return true;
+  }
+
+  // Grows the file (and mapping) to at least `size` bytes. Invalidates data().
+  bool reserve(size_t size) {
+    if (!writable_) return false;
+    if (size <= cap_) return true;
+    size_t ncap = cap_ ? cap_ : (1u << 20);
+    while (ncap < size) ncap *= 2;
+    if (ftruncate(fd_, (off_t)ncap) != 0) return false;
+    if (data_) munmap(data_, cap_);
+    void* p = mmap(nullptr, ncap, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) { data_ = nullptr; cap_ = 0; return false; }
+    data_ = (uint8_t*)p;
+    cap_ = ncap;
+    return true;
+  }
+
+  // Unmaps and, for writable files, trims the file to `final_size`.
+  void close(size_t final_size = 0) {
+    if (data_) { munmap(data_, cap_); data_ = nullptr; }
+    if (fd_ >= 0) {
+      if (writable_ && final_size) { if (ftruncate(fd_, (off_t)final_size) != 0) LOGE("log truncate failed"); }
+      ::close(fd_);
+      fd_ = -1;
+    }
+    cap_ = 0;
+    writable_ = false;
+  }
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return cap_; }
+
+private:
+  int fd_{-1};
+  bool writable_{false};
+  uint8_t* data_{nullptr};
+  size_t cap_{0};
+};
+
+class SessionRecorder {
+public:
+  bool start(const std::string& path) {
+    std::lock_guard<std::mutex> lk(life_mu_);
+    if (active_.load()) return false;
+    finish(); // a writer that failed earlier is still waiting to be joined
+    if (!log_.create(path, 64u << 20)) return false;
+    if (!idx_.create(path + ".idx", 1u << 20)) { log_.close(); return false; }
+
+    LogFileHeader h{kLogMagic, kLogVersion, 0};
+    std::memcpy(log_.data(), &h, sizeof(h));
+    h.magic = kLogIndexMagic;
+    std::memcpy(idx_.data(), &h, sizeof(h));
+    log_end_ = sizeof(LogFileHeader);
+    idx_end_ = sizeof(LogFileHeader);
+    pending_bytes_ = 0;
+    dropped_ = 0;
+
+    active_.store(1);
+    th_ = std::thread(&SessionRecorder::run, this);
+    return true;
+  }
+
+  void stop() {
+    std::lock_guard<std::mutex> lk(life_mu_);
+    {
+      // Under mu_ so the writer cannot miss the wake-up between checking
+      // its wait predicate and blocking.
+      std::lock_guard<std::mutex> qlk(mu_);
+      active_.store(0);
+    }
+    finish();
+  }
+
+  bool active() const { return active_.load(std::memory_order_relaxed) != 0; }
+
+  void add_packet(const EncodedPacket& pkt, std::string&& data, int64_t sent_ns) {
+    Record r;
+    r.hdr = make_header(kLogRecPacket, pkt.role, pkt.frame_index, pkt.ts_ns, sent_ns);
+    r.hdr.w = pkt.w; r.hdr.h = pkt.h;
+    r.hdr.slice_index = (uint16_t)pkt.slice_index;
+    r.hdr.slice_count = (uint16_t)pkt.slice_count;
+    r.hdr.slice_y = (uint32_t)pkt.slice_y;
+    r.hdr.format = (uint32_t)pkt.format;
+    r.hdr.keyframe = pkt.keyframe ? 1 : 0;
+    r.stream_id = pkt.stream_id;
+    r.camera_id = pkt.camera_id;
+    r.payload = std::move(data);
+    push(std::move(r));
+  }
+
+  void add_result(AIV_CamRole role, const vision::Result& res, int64_t recv_ns) {
+    Record r;
+    r.hdr = make_header(kLogRecResult, role, (int64_t)res.frame_index(), res.timestamp_ns(), recv_ns);
+    r.stream_id = res.stream_id();
+    if (!res.SerializeToString(&r.payload)) return;
+    push(std::move(r));
+  }
+
+private:
+  struct Record {
+    LogRecordHeader hdr{};
+    std::string stream_id;
+    std::string camera_id;
+    std::string payload;
+  };
+
+  // Producers never block on disk; past this much queued data records are dropped.
+  static constexpr size_t kMaxPendingBytes = 64u << 20;
+
+  static LogRecordHeader make_header(uint32_t type, AIV_CamRole role, int64_t frame_index,
+                                     uint64_t ts_ns, int64_t wall_ns) {
+    LogRecordHeader h{};
+    h.type = type;
+    h.role = (int32_t)role;
+    h.frame_index = frame_index;
+    h.ts_ns = ts_ns;
+    h.wall_ns = wall_ns;
+    return h;
+  }
+
+  void finish() {
+    cv_.notify_all();
+    if (!th_.joinable()) return;
+    th_.join();
+    log_.close(log_end_);
+    idx_.close(idx_end_);
+    q_.clear();
+    if (dropped_) LOGE("recorder: dropped %llu records", (unsigned long long)dropped_);
+  }
+
+  void push(Record&& r) {
+    const size_t bytes = r.payload.size() + sizeof(LogRecordHeader);
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (!active_.load()) return;
+      if (pending_bytes_ + bytes > kMaxPendingBytes) { dropped_++; return; }
+      pending_bytes_ += bytes;
+      q_.push_back(std::move(r));
+    }
+    cv_.notify_one();
+  }
+
+  void run() {
+    std::vector<Record> batch;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&]{ return !q_.empty() || !active_.load(); });
+        if (q_.empty() && !active_.load()) break;
+        batch.assign(std::make_move_iterator(q_.begin()), std::make_move_iterator(q_.end()));
+        q_.clear();
+        pending_bytes_ = 0;
+      }
+      for (Record& r : batch) {
+        if (!write(r)) {
+          LOGE("recorder: write failed, stopping");
+          if (g_on_error) g_on_error(AIV_ERR_IO, "Session recorder write failed.");
+          active_.store(0);
+          return;
+        }
+      }
+      batch.clear();
+    }
+  }
+
+  bool write(Record& r) {
+    r.hdr.stream_id_len = (uint32_t)r.stream_id.size();
+    r.hdr.camera_id_len = (uint32_t)r.camera_id.size();
+    r.hdr.payload_len   = (uint64_t)r.payload.size();
+    const uint64_t off = log_end_;
+    const uint64_t len = align8(sizeof(LogRecordHeader) + r.stream_id.size() + r.camera_id.size() + r.payload.size());
+    if (!log_.reserve(off + len)) return false;
+
+    uint8_t* p = log_.data() + off;
+    std::memcpy(p, &r.hdr, sizeof(r.hdr));                  p += sizeof(r.hdr);
+    std::memcpy(p, r.stream_id.data(), r.stream_id.size()); p += r.stream_id.size();
+    std::memcpy(p, r.camera_id.data(), r.camera_id.size()); p += r.camera_id.size();
+    std::memcpy(p, r.payload.data(), r.payload.size());
+    log_end_ = off + len;
+
+    if (r.hdr.frame_index < 0) return true;
+    const uint64_t slot = (uint64_t)r.hdr.frame_index * 2 + (r.hdr.role == AIV_CAM_RIGHT ? 1 : 0);
+    const uint64_t ioff = sizeof(LogFileHeader) + slot * sizeof(LogIndexEntry);
+    if (!idx_.reserve(ioff + sizeof(LogIndexEntry))) return false;
+    LogIndexEntry* e = reinterpret_cast<LogIndexEntry*>(idx_.data() + ioff);
+    // A sliced frame is indexed by its first band so a seek replays it whole.
+    if (r.hdr.type == kLogRecPacket) {
+      if (r.hdr.slice_index == 0 || !e->packet_off) e->packet_off = off;
+    } else {
+      e->result_off = off;
+    }
+    idx_end_ = std::max<uint64_t>(idx_end_, ioff + sizeof(LogIndexEntry));
+    return true;
+  }
+
+  std::mutex life_mu_;
+  std::atomic<int> active_{0};
+  std::thread th_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Record> q_;
+  size_t pending_bytes_{0};
+  uint64_t dropped_{0};
+
+  MappedFile log_;
+  MappedFile idx_;
+  uint64_t log_end_{0};
+  uint64_t idx_end_{0};
+};
+
+static SessionRecorder g_recorder;
+
+static std::thread g_replay_thread;
+static std::atomic<int> g_replaying{0};
+
+static void replay_loop(std::string path, AIV_ReplayConfig cfg) {
+  MappedFile log, idx;
+  if (!log.open_ro(path) || log.size() < sizeof(LogFileHeader) ||
+      reinterpret_cast<const LogFileHeader*>(log.data())->magic != kLogMagic ||
+      reinterpret_cast<const LogFileHeader*>(log.data())->version != kLogVersion) {
+    if (g_on_error) g_on_error(AIV_ERR_IO, "Failed to open session log.");
+    g_replaying.store(0);
+    return;
+  }
+
+  // O(1) seek: the index slot of start_frame holds the record offset directly.
+  // Each role's frame_index counts separately, so the earliest of the two
+  // roles' first recorded frames at or after start_frame is where both start.
+  // An H.264 role backs up to the keyframe its first frame depends on.
+  uint64_t off = sizeof(LogFileHeader);
+  int64_t from[2] = {cfg.start_frame, cfg.start_frame};
+  if (cfg.start_frame > 0 && idx.open_ro(path + ".idx")) {
+    const size_t n_slots = (idx.size() - sizeof(LogFileHeader)) / sizeof(LogIndexEntry);
+    const LogIndexEntry* e = reinterpret_cast<const LogIndexEntry*>(idx.data() + sizeof(LogFileHeader));
+    uint64_t first = 0;
+    for (size_t r = 0; r < 2; ++r) {
+      size_t slot = (size_t)cfg.start_frame * 2 + r;
+      while (slot < n_slots && !e[slot].packet_off) slot += 2;
+      if (slot >= n_slots) continue;
+      uint64_t o = e[slot].packet_off;
+      for (size_t k = slot; k >= 2;) {
+        LogRecordHeader h;
+        if (o + sizeof(h) > log.size()) break;
+        std::memcpy(&h, log.data() + o, sizeof(h));
+        if (h.format != vision::IMAGE_FORMAT_H264 || h.keyframe) break;
+        k -= 2;
+        if (e[k].packet_off) { o = e[k].packet_off; from[r] = (int64_t)(k / 2); }
+      }
+      first = first ? std::min(first, o) : o;
+    }
+    if (first) off = first;
+  }
+
+  // frame_index counts per camera and the two can drift apart (decimation),
+  // so each role stops on its own and replay ends once both have.
+  bool done[2] = {false, false};
+  // H.264 is only decodable from a keyframe on: at the start, and again after
+  // a packet of that role had to be dropped.
+  bool need_key[2] = {true, true};
+  const int64_t t0 = AIV_GetElapsedRealtimeNanos();
+  int64_t w0 = -1;
+  while (g_running.load() && !(done[0] && done[1]) && off + sizeof(LogRecordHeader) <= log.size()) {
+    LogRecordHeader h;
+    std::memcpy(&h, log.data() + off, sizeof(h));
+    const uint64_t body = (uint64_t)h.stream_id_len + h.camera_id_len + h.payload_len;
+    if (h.type != kLogRecPacket && h.type != kLogRecResult) break;
+    if (off + sizeof(h) + body > log.size()) break;
+    const uint8_t* p = log.data() + off + sizeof(h);
+    off += align8(sizeof(h) + body);
+
+    if (h.type != kLogRecPacket) continue;
+    const int r = (h.role == AIV_CAM_RIGHT) ? 1 : 0;
+    if (h.frame_index < from[r]) continue;
+    if (cfg.end_frame >= 0 && h.frame_index > cfg.end_frame) done[r] = true;
+    if (done[r]) continue;
+    const bool h264 = h.format == vision::IMAGE_FORMAT_H264;
+    if (h264 && need_key[r] && !h.keyframe) continue;
+
+    CamContext* cc = (h.role == AIV_CAM_RIGHT) ? &g_right : &g_left;
+    if (!cfg.max_speed) {
+      if (w0 < 0) w0 = h.wall_ns;
+      const int64_t due = t0 + (h.wall_ns - w0);
+      for (int64_t now = AIV_GetElapsedRealtimeNanos(); g_running.load() && due > now;
+           now = AIV_GetElapsedRealtimeNanos()) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<int64_t>(due - now, 10000000LL)));
+      }
+    } else {
+      while (g_running.load() && cc->enc_q->full())
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    EncodedPacket pkt;
+    pkt.role = (h.role == AIV_CAM_RIGHT) ? AIV_CAM_RIGHT : AIV_CAM_LEFT;
+    pkt.w = h.w; pkt.h = h.h;
+    pkt.frame_index = h.frame_index;
+    pkt.ts_ns = h.ts_ns;
+    pkt.slice_index = h.slice_index;
+    pkt.slice_count = h.slice_count ? h.slice_count : 1;
+    pkt.slice_y = (int)h.slice_y;
+    pkt.format = (int)h.format;
+    pkt.keyframe = h.keyframe != 0;
+    pkt.stream_id.assign((const char*)p, h.stream_id_len);  p += h.stream_id_len;
+    pkt.camera_id.assign((const char*)p, h.camera_id_len);  p += h.camera_id_len;
+    pkt.data.assign(p, p + h.payload_len);
+    // As live: evicting a queued H.264 picture would break the ones after it.
+    if (!h264) cc->enc_q->push(std::move(pkt));
+    else need_key[r] = !cc->enc_q->push_if_room(std::move(pkt));
+  }
+  g_replaying.store(0);
+}
+
 static void encode_loop(CamContext* cc);
-static void send_loop();
-static void recv_loop();
 
 #if defined(__ANDROID__)
 static void close_camera(CamContext* cc);
@@ -195,36 +1015,49 @@ static void on_image_available(void* ctx, AImageReader* reader) {
   AImage_getPlaneData(img, 2, &vptr, &vlen);
   AImage_getPlaneRowStride(img, 2, &vs);
 
+  const AIV_StreamPolicy policy = g_live.load().stream[role_index(cc->role)];
+  int64_t ts; AImage_getTimestamp(img, &ts);
+  if (!admit_frame(cc, ts, policy.max_fps)) {
+    AImage_delete(img);
+    return;
+  }
+
   I420Frame f;
   f.role = cc->role;
   f.w = w; f.h = h;
   int64_t idx = cc->idx.fetch_add(1, std::memory_order_relaxed);
   f.frame_index = idx;
-
-  int64_t ts; AImage_getTimestamp(img, &ts);
   f.ts_ns = (uint64_t)(ts < 0 ? 0 : ts);
 
   const int y_size = w*h;
   const int uv_w = (w + 1) >> 1;
   const int uv_h = (h + 1) >> 1;
   const int uv_size = uv_w * uv_h;
-  f.data.resize(y_size + uv_size + uv_size);
-
-  int r = libyuv::Android420ToI420(
-    yptr, ys,
-    uptr, us,
-    vptr, vs,
-    uv_ps,
-    f.data.data(), w,
-    f.data.data() + y_size, uv_w,
-    f.data.data() + y_size + uv_size, uv_w,
-    w, h
-  );
+
+  int r = 0;
+  if (g_color_mode.load(std::memory_order_relaxed) == AIV_COLOR_GRAY) {
+    f.gray = true;
+    f.data.resize(y_size);
+    libyuv::CopyPlane(yptr, ys, f.data.data(), w, w, h);
+  } else {
+    f.data.resize(y_size + uv_size + uv_size);
+    r = libyuv::Android420ToI420(
+      yptr, ys,
+      uptr, us,
+      vptr, vs,
+      uv_ps,
+      f.data.data(), w,
+      f.data.data() + y_size, uv_w,
+      f.data.data() + y_size + uv_size, uv_w,
+      w, h
+    );
+  }
 
   AImage_delete(img);
   if (r != 0) return;
 
-  if (cc->raw_q) cc->raw_q->push(std::move(f));
+  g_startup.mark(g_startup.first_frame);
+  enqueue(cc->raw_q.get(), std::move(f), policy.drop_policy);
 }
 
 static void on_cam_disconnected(void* ctx, ACameraDevice* dev) {
@@ -399,38 +1232,396 @@ static void close_camera(CamContext* cc) {
     cc->device = nullptr;
   }
 }
+#else
+// Stand-in camera for hosts without the NDK camera stack: a scrolling
+// gradient at the configured size and rate, so the pipeline and its startup
+// timing can be exercised against a local server.
+static void synthetic_loop(CamContext* cc) {
+  const int w = (cc->cfg.width  > 0) ? (cc->cfg.width  & ~1) : 640;
+  const int h = (cc->cfg.height > 0) ? (cc->cfg.height & ~1) : 480;
+  const int fps = (cc->cfg.fps > 0) ? cc->cfg.fps : 30;
+  const size_t y_size = (size_t)w * h;
+  const size_t uv_size = (size_t)(w / 2) * (h / 2);
+  const bool gray = g_color_mode.load() == AIV_COLOR_GRAY;
+  const auto period = std::chrono::nanoseconds(1000000000LL / fps);
+  auto next = std::chrono::steady_clock::now();
+
+  for (int64_t n = 0; g_running.load(); ++n) {
+    const int64_t ts = AIV_GetElapsedRealtimeNanos();
+    const AIV_StreamPolicy policy = g_live.load().stream[role_index(cc->role)];
+    if (admit_frame(cc, ts, policy.max_fps)) {
+      I420Frame f;
+      f.role = cc->role;
+      f.w = w; f.h = h;
+      f.frame_index = cc->idx.fetch_add(1, std::memory_order_relaxed);
+      f.ts_ns = (uint64_t)ts;
+      f.gray = gray;
+      f.data.resize(gray ? y_size : y_size + 2 * uv_size);
+      for (int y = 0; y < h; ++y) std::memset(f.data.data() + (size_t)y * w, (int)((y + 4 * n) & 0xff), w);
+      if (!gray) std::memset(f.data.data() + y_size, 128, 2 * uv_size);
+      g_startup.mark(g_startup.first_frame);
+      enqueue(cc->raw_q.get(), std::move(f), policy.drop_policy);
+    }
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+}
 #endif // __ANDROID__
 
+static bool start_capture(CamContext* cc) {
+  cc->idx.store(0);
+  cc->gate_next_ns = cc->gate_last_ns = 0;
+  const char* side = (cc->role == AIV_CAM_RIGHT) ? "RIGHT" : "LEFT";
+  (void)side;
+  LOGI("StartStreamingStereo: opening %s id=%s", side, cc->cam_id.c_str());
+#if defined(__ANDROID__)
+  if (!open_camera(cc)) {
+    LOGE("StartStreamingStereo: failed to open %s id=%s", side, cc->cam_id.c_str());
+    return false;
+  }
+#else
+  cc->synth_th = std::thread(synthetic_loop, cc);
+#endif
+  LOGI("StartStreamingStereo: opened %s id=%s", side, cc->cam_id.c_str());
+  g_startup.mark(g_startup.camera_open[role_index(cc->role)]);
+  return true;
+}
+
+static void stop_capture(CamContext* cc) {
+#if defined(__ANDROID__)
+  close_camera(cc);
+#else
+  if (cc->synth_th.joinable()) cc->synth_th.join();
+#endif
+}
+
+// Inter-frame coding: a packet dropped from enc_q breaks the reference chain
+// on the server, so the next picture after any drop is forced to be an IDR.
+#if defined(AIV_HAVE_OPENH264)
+// Frame rate the H.264 rate control budgets for: the capture rate, capped by
+// the camera's max_fps.
+static int h264_fps(const CamContext* cc, const AIV_StreamPolicy& policy) {
+  int fps = (cc->cfg.fps > 0) ? cc->cfg.fps : 30;
+  if (policy.max_fps > 0.0f) fps = std::max(1, std::min(fps, (int)(policy.max_fps + 0.5f)));
+  return fps;
+}
+#endif
+
+static void encode_h264(CamContext* cc, const I420Frame& in, EncodedPacket&& pkt,
+                        const AIV_StreamPolicy& policy) {
+#if defined(AIV_HAVE_OPENH264)
+  static thread_local uint64_t seen_drops = 0;
+  bool force_idr = false;
+  const int fps = h264_fps(cc, policy);
+  // A live max_fps change only needs rate control retargeted; reopen if the
+  // encoder refuses.
+  if (!cc->h264.matches(in.w, in.h) || !cc->h264.set_fps(fps)) {
+    if (!cc->h264.open(in.w, in.h, fps, g_video_cfg)) {
+      if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "H.264 encoder init failed.");
+      return;
+    }
+    force_idr = true;
+  }
+  const uint64_t drops = cc->enc_q ? cc->enc_q->dropped() : 0;
+  if (drops != seen_drops) { seen_drops = drops; force_idr = true; }
+
+  bool key = false;
+  if (!cc->h264.encode(in.data.data(), in.ts_ns, force_idr, pkt.data, &key)) {
+    if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "H.264 encode failed.");
+    return;
+  }
+  if (pkt.data.empty()) return;
+  pkt.format = vision::IMAGE_FORMAT_H264;
+  pkt.keyframe = key;
+  // Always drop-newest: evicting a queued picture would leave the P-frames
+  // behind it referencing one the server never gets. A drop here is instead
+  // the newest picture, and the next one is forced to an IDR above.
+  cc->enc_q->push_if_room(std::move(pkt));
+#else
+  (void)cc; (void)in; (void)pkt; (void)policy;
+#endif
+}
+
+// Resizes in place to the configured output size; a zero dimension follows
+// the other one's aspect ratio, both zero keep the capture size.
+static bool scale_to_output(I420Frame& in, const AIV_JpegConfig& jc, std::vector<uint8_t>& tmp) {
+  int ow = jc.jpeg_width, oh = jc.jpeg_height;
+  if (!ow && !oh) return true;
+  if (!ow) ow = (int)((int64_t)in.w * oh / std::max(1, in.h));
+  if (!oh) oh = (int)((int64_t)in.h * ow / std::max(1, in.w));
+  ow = std::max(2, ow & ~1);
+  oh = std::max(2, oh & ~1);
+  if (ow == in.w && oh == in.h) return true;
+
+  if (in.gray) {
+    tmp.resize((size_t)ow * oh);
+    libyuv::ScalePlane(in.data.data(), in.w, in.w, in.h, tmp.data(), ow, ow, oh, libyuv::kFilterBox);
+    in.data.swap(tmp);
+    in.w = ow;
+    in.h = oh;
+    return true;
+  }
+
+  const int uv_iw = (in.w + 1) >> 1, uv_ih = (in.h + 1) >> 1;
+  const int uv_ow = ow >> 1, uv_oh = oh >> 1;
+  tmp.resize((size_t)ow * oh + 2 * (size_t)uv_ow * uv_oh);
+  const uint8_t* sy = in.data.data();
+  const uint8_t* su = sy + (size_t)in.w * in.h;
+  const uint8_t* sv = su + (size_t)uv_iw * uv_ih;
+  uint8_t* dy = tmp.data();
+  uint8_t* du = dy + (size_t)ow * oh;
+  uint8_t* dv = du + (size_t)uv_ow * uv_oh;
+  if (libyuv::I420Scale(sy, in.w, su, uv_iw, sv, uv_iw, in.w, in.h,
+                        dy, ow, du, uv_ow, dv, uv_ow, ow, oh, libyuv::kFilterBox) != 0) return false;
+  in.data.swap(tmp);
+  in.w = ow;
+  in.h = oh;
+  return true;
+}
+
+// Runs one throwaway encode at the expected output size so the compressor
+// handle, libjpeg's internal buffers and (for H.264) the encoder itself are
+// set up while the connection and cameras are still opening.
+static void warm_up_encoder(CamContext* cc, std::vector<uint8_t>& scratch) {
+  I420Frame f;
+  f.w = (cc->cfg.width  > 0) ? (cc->cfg.width  & ~1) : 640;
+  f.h = (cc->cfg.height > 0) ? (cc->cfg.height & ~1) : 480;
+  f.gray = g_color_mode.load() == AIV_COLOR_GRAY;
+  f.data.assign(f.gray ? (size_t)f.w * f.h : (size_t)f.w * f.h * 3 / 2, 128);
+  if (!scale_to_output(f, g_live.load().jpeg, scratch)) return;
+  if (g_video_cfg.codec == AIV_CODEC_RAW) return;
+#if defined(AIV_HAVE_OPENH264)
+  if (g_video_cfg.codec == AIV_CODEC_H264) {
+    cc->h264.open(f.w, f.h, h264_fps(cc, g_live.load().stream[role_index(cc->role)]), g_video_cfg);
+    return;
+  }
+#endif
+  std::vector<uint8_t> jpeg;
+  I420ToJpeg(f.data.data(), f.w, f.h, f.gray, g_live.load().jpeg.jpeg_quality, jpeg);
+}
+
 static void encode_loop(CamContext* cc) {
   if (!cc) return;
   cc->encode_running.store(1);
+  std::vector<uint8_t> scaled;
+  if (cc->cam_id.size()) {
+    warm_up_encoder(cc, scaled);
+    g_startup.mark_last(g_startup.encoder_ready);
+  }
   while (g_running.load()) {
     I420Frame in;
     if (!cc->raw_q || !cc->raw_q->pop(in)) {
       std::this_thread::sleep_for(std::chrono::milliseconds(1));
       continue;
     }
+    const AIV_LiveConfig lc = g_live.load();
+    const AIV_StreamPolicy& policy = lc.stream[role_index(cc->role)];
+    if (!scale_to_output(in, lc.jpeg, scaled)) {
+      if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "Frame scaling failed.");
+      continue;
+    }
+
     EncodedPacket pkt;
     pkt.role = in.role; pkt.w = in.w; pkt.h = in.h;
     pkt.frame_index = in.frame_index; pkt.ts_ns = in.ts_ns;
     pkt.camera_id = cc->cam_id;
     pkt.stream_id = g_stream_base + "_" + role_suffix(cc->role);
+    pkt.config_version = lc.version;
 
-    std::vector<uint8_t> jpeg;
-    AIV_JpegConfig jc; { jc = g_jpeg_cfg; }
-    if (!I420ToJpeg(in.data.data(), in.w, in.h, jc.jpeg_quality, jpeg)) {
-      if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "JPEG encode failed.");
+    if (g_video_cfg.codec == AIV_CODEC_RAW) {
+      pkt.format = in.gray ? vision::IMAGE_FORMAT_GRAY8 : vision::IMAGE_FORMAT_I420;
+      pkt.data = std::move(in.data);
+      enqueue(cc->enc_q.get(), std::move(pkt), policy.drop_policy);
       continue;
     }
-    pkt.jpeg = std::move(jpeg);
-    if (cc->enc_q) cc->enc_q->push(std::move(pkt));
+
+    if (g_video_cfg.codec == AIV_CODEC_H264) {
+      // Flat chroma costs the encoder next to nothing.
+      if (in.gray) in.data.resize((size_t)in.w * in.h + 2 * (size_t)((in.w + 1) / 2) * ((in.h + 1) / 2), 128);
+      encode_h264(cc, in, std::move(pkt), policy);
+      continue;
+    }
+
+    const AIV_JpegConfig& jc = lc.jpeg;
+
+    // Bands are multiples of 16 rows (one 4:2:0 MCU row) so every band is a
+    // standalone JPEG. Each one is queued as soon as it is encoded, letting
+    // send_loop transmit it while the next band is being compressed.
+    const int slices = std::max(1, std::min<int>(g_slice_count.load(std::memory_order_relaxed), in.h / 16));
+    const int band = (slices > 1) ? ((in.h + slices - 1) / slices + 15) & ~15 : in.h;
+    const int count = (in.h + band - 1) / band;
+    // Drop-newest drops whole frames: one that cannot be queued in full is
+    // not encoded at all.
+    if (count > 1 && policy.drop_policy == AIV_DROP_NEWEST && cc->enc_q->free_slots() < (size_t)count) continue;
+    for (int i = 0; i < count; ++i) {
+      const int y0 = i * band;
+      std::vector<uint8_t> jpeg;
+      if (!I420RowsToJpeg(in.data.data(), in.w, in.h, in.gray, y0, std::min(band, in.h - y0), jc.jpeg_quality, jpeg)) {
+        if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "JPEG encode failed.");
+        break;
+      }
+      EncodedPacket part = (i + 1 < count) ? pkt : std::move(pkt);
+      part.data = std::move(jpeg);
+      part.slice_index = i;
+      part.slice_count = count;
+      part.slice_y = y0;
+      enqueue(cc->enc_q.get(), std::move(part), policy.drop_policy);
+    }
   }
+#if defined(AIV_HAVE_OPENH264)
+  cc->h264.close();
+#endif
   cc->encode_running.store(0);
 }
 
-static std::thread g_send_thread;
-static void send_loop() {
-  int turn = 0;
+static void fill_frame(CamContext* cc, const EncodedPacket& pkt, vision::Frame& f) {
+  f.set_frame_index((uint64_t)pkt.frame_index);
+  f.set_timestamp_ns(pkt.ts_ns);
+  f.set_width((uint32_t)pkt.w);
+  f.set_height((uint32_t)pkt.h);
+  f.set_format((vision::ImageFormat)pkt.format);
+  f.set_config_version(pkt.config_version);
+  if (pkt.format == vision::IMAGE_FORMAT_H264) f.set_keyframe(pkt.keyframe);
+  f.set_data(std::string(reinterpret_cast<const char*>(pkt.data.data()), pkt.data.size()));
+  if (cc->result_encoding.load(std::memory_order_relaxed) == AIV_RESULT_PACKED)
+    f.set_result_encoding(vision::RESULT_ENCODING_PACKED);
+  if (pkt.slice_count > 1) {
+    f.set_slice_index((uint32_t)pkt.slice_index);
+    f.set_slice_count((uint32_t)pkt.slice_count);
+    f.set_slice_y((uint32_t)pkt.slice_y);
+  }
+}
+
+// Bookkeeping once a frame is on the wire: the recorder takes the payload,
+// and on_frame_sent fires after the last slice of a frame.
+static void frame_sent(const EncodedPacket& pkt, std::string&& data, int64_t sent_ns) {
+  g_startup.mark(g_startup.first_send);
+  if (g_recorder.active()) g_recorder.add_packet(pkt, std::move(data), sent_ns);
+  if (pkt.slice_index + 1 < pkt.slice_count) return;
+
+  char idbuf[128];
+  std::snprintf(idbuf, sizeof(idbuf), "%s_%lld", pkt.stream_id.c_str(), (long long)pkt.frame_index);
+  if (g_on_frame_sent) g_on_frame_sent(idbuf, pkt.frame_index, (double)pkt.ts_ns * 1e-9);
+}
+
+// Frames collected for one StreamDetectBatched message. Stream ids go out
+// once per session as StreamInfo declarations; frames carry only the key.
+class FrameBatcher {
+public:
+  explicit FrameBatcher(const AIV_BatchConfig& cfg) : cfg_(cfg) {}
+
+  bool empty() const { return pkts_.empty(); }
+
+  void add(CamContext* cc, EncodedPacket&& pkt, int64_t now_ns) {
+    StreamKey& k = keys_[cc->role == AIV_CAM_RIGHT ? 1 : 0];
+    if (!k.key || k.stream_id != pkt.stream_id || k.camera_id != pkt.camera_id) {
+      k.key = ++next_key_;
+      k.stream_id = pkt.stream_id;
+      k.camera_id = pkt.camera_id;
+      vision::StreamInfo* si = msg_.add_streams();
+      si->set_key(k.key);
+      si->set_stream_id(k.stream_id);
+      si->set_camera_id(k.camera_id);
+    }
+    vision::Frame* f = msg_.add_frames();
+    fill_frame(cc, pkt, *f);
+    f->set_stream_key(k.key);
+
+    if (pkts_.empty()) first_ns_ = now_ns;
+    bytes_ += pkt.data.size();
+    pkt.data.clear();
+    pkt.data.shrink_to_fit();
+    pkts_.push_back(std::move(pkt));
+  }
+
+  bool due(int64_t now_ns) const {
+    if (pkts_.empty()) return false;
+    return (int32_t)pkts_.size() >= cfg_.max_frames ||
+           bytes_ >= (size_t)cfg_.max_bytes ||
+           now_ns - first_ns_ >= (int64_t)cfg_.max_delay_us * 1000;
+  }
+
+  // Time until the oldest frame reaches max_delay, for the idle sleep.
+  int64_t wait_ns(int64_t now_ns) const {
+    return std::max<int64_t>(0, first_ns_ + (int64_t)cfg_.max_delay_us * 1000 - now_ns);
+  }
+
+  bool flush(grpc::ClientReaderWriter<vision::FrameBatch, vision::Result>* stream) {
+    const int64_t send_ns = AIV_GetElapsedRealtimeNanos();
+    for (auto& f : *msg_.mutable_frames()) f.set_client_send_ns((uint64_t)send_ns);
+    const bool ok = stream->Write(msg_);
+    if (ok) {
+      for (size_t i = 0; i < pkts_.size(); ++i)
+        frame_sent(pkts_[i], std::move(*msg_.mutable_frames((int)i)->mutable_data()), send_ns);
+    }
+    msg_.Clear();
+    pkts_.clear();
+    bytes_ = 0;
+    return ok;
+  }
+
+private:
+  struct StreamKey { uint32_t key{0}; std::string stream_id, camera_id; };
+
+  AIV_BatchConfig cfg_;
+  vision::FrameBatch msg_;
+  std::vector<EncodedPacket> pkts_;
+  size_t bytes_{0};
+  int64_t first_ns_{0};
+  StreamKey keys_[2];
+  uint32_t next_key_{0};
+};
+
+// Smooth weighted round robin over the cameras that have something queued:
+// each turn every ready camera earns its priority, the one with the most
+// credit sends and pays back the total, so 3:1 comes out as L L R L rather
+// than in bursts. Equal priorities reduce to plain alternation.
+class SendScheduler {
+public:
+  // mask: bit i set = camera i is sent from this thread.
+  explicit SendScheduler(unsigned mask) : mask_(mask) {}
+
+  CamContext* next() {
+    CamContext* cams[2] = {&g_left, &g_right};
+    auto ready = [&](int i) { return ((mask_ >> i) & 1u) && cams[i]->enc_q && !cams[i]->enc_q->empty(); };
+    if (!ready(0) && !ready(1)) return nullptr;
+    const AIV_LiveConfig lc = g_live.load();
+    int64_t total = 0;
+    int best = -1;
+    for (int i = 0; i < 2; ++i) {
+      if (!ready(i)) continue;
+      const int64_t w = std::max<int32_t>(1, lc.stream[i].priority);
+      credit_[i] += w;
+      total += w;
+      if (best < 0 || credit_[i] > credit_[best]) best = i;
+    }
+    if (best < 0) return nullptr;
+    credit_[best] -= total;
+    return cams[best];
+  }
+
+private:
+  unsigned mask_;
+  int64_t credit_[2]{0, 0};
+};
+
+static void send_loop(Link* link, unsigned cam_mask) {
+  const AIV_BatchConfig bc = g_batch_cfg;
+  const bool batched = bc.max_frames > 1;
+  FrameBatcher batch(bc);
+
+  auto flush_batch = [&]() {
+    grpc::ClientReaderWriter<vision::FrameBatch, vision::Result>* stream = nullptr;
+    {
+      std::lock_guard<std::mutex> lk(link->mu);
+      stream = link->batch_stream.get();
+    }
+    if (stream && batch.flush(stream)) return;
+    if (g_running.load() && g_on_error) g_on_error(AIV_ERR_GRPC, "Write failed on streaming RPC.");
+    g_running.store(0);
+  };
+
+  SendScheduler sched(cam_mask);
   while (g_running.load()) {
     bool sent = false;
 
@@ -439,105 +1630,335 @@ static void send_loop() {
       EncodedPacket pkt;
       if (!cc->enc_q->pop(pkt)) return false;
 
+      // Drop-oldest evicts single bands. Once a frame has lost one before it
+      // went out, the server can never complete it, so the rest of its bands
+      // are discarded here instead of sent.
+      if (pkt.slice_count > 1) {
+        if (pkt.slice_index == 0) cc->send_frame = pkt.frame_index;
+        else if (pkt.frame_index != cc->send_frame || pkt.slice_index != cc->send_slice) return true;
+        cc->send_slice = pkt.slice_index + 1;
+      }
+
+      if (batched) {
+        batch.add(cc, std::move(pkt), AIV_GetElapsedRealtimeNanos());
+        return true;
+      }
+
       vision::Frame f;
       f.set_stream_id(pkt.stream_id);
       f.set_camera_id(pkt.camera_id);
-      f.set_frame_index((uint64_t)pkt.frame_index);
-      f.set_timestamp_ns(pkt.ts_ns);
-      f.set_width((uint32_t)pkt.w);
-      f.set_height((uint32_t)pkt.h);
-      f.set_format(vision::IMAGE_FORMAT_JPEG);
-      f.set_data(std::string(reinterpret_cast<const char*>(pkt.jpeg.data()), pkt.jpeg.size()));
+      fill_frame(cc, pkt, f);
 
       grpc::ClientReaderWriter<vision::Frame, vision::Result>* stream = nullptr;
       {
-        std::lock_guard<std::mutex> lk(g_stream_mu);
-        if (!g_stream) return false;
-        stream = g_stream.get();
+        std::lock_guard<std::mutex> lk(link->mu);
+        if (!link->stream) return false;
+        stream = link->stream.get();
       }
 
+      f.set_client_send_ns((uint64_t)AIV_GetElapsedRealtimeNanos());
       if (!stream->Write(f)) {
         if (g_on_error) g_on_error(AIV_ERR_GRPC, "Write failed on streaming RPC.");
         g_running.store(0);
         return true;
       }
 
-      char idbuf[128];
-      std::snprintf(idbuf, sizeof(idbuf), "%s_%lld", pkt.stream_id.c_str(), (long long)pkt.frame_index);
-      if (g_on_frame_sent) g_on_frame_sent(idbuf, pkt.frame_index, (double)pkt.ts_ns * 1e-9);
+      frame_sent(pkt, std::move(*f.mutable_data()), AIV_GetElapsedRealtimeNanos());
       return true;
     };
 
-    if (turn % 2 == 0) {
-      sent = try_send_from(&g_left) || try_send_from(&g_right);
-    } else {
-      sent = try_send_from(&g_right) || try_send_from(&g_left);
+    sent = try_send_from(sched.next());
+
+    if (batched) {
+      const int64_t now = AIV_GetElapsedRealtimeNanos();
+      if (batch.due(now)) {
+        flush_batch();
+        continue;
+      }
+      if (!sent) {
+        const int64_t wait = batch.empty() ? 1000000 : std::min<int64_t>(1000000, batch.wait_ns(now));
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+      }
+      continue;
     }
-    turn++;
 
     if (!sent) std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
 
-  std::lock_guard<std::mutex> lk(g_stream_mu);
-  if (g_stream) g_stream->WritesDone();
+  if (batched && !batch.empty()) flush_batch();
+
+  std::lock_guard<std::mutex> lk(link->mu);
+  if (link->stream) link->stream->WritesDone();
+  if (link->batch_stream) link->batch_stream->WritesDone();
 }
 
-static std::thread g_recv_thread;
-static void recv_loop() {
-  while (g_running.load()) {
+static void fill_latency(const vision::Result& res, int64_t t3, AIV_FrameLatency* lat) {
+  *lat = AIV_FrameLatency{};
+  if (!res.client_send_ns() || !res.server_recv_ns() || !res.server_send_ns()) return;
+  const int64_t t0 = (int64_t)res.client_send_ns();
+  const int64_t t1 = (int64_t)res.server_recv_ns();
+  const int64_t t2 = (int64_t)res.server_send_ns();
+  const int64_t ti = res.inference_start_ns() ? (int64_t)res.inference_start_ns() : t1;
+  g_clock.add(t0, t1, t2, t3);
+
+  int64_t off = 0;
+  if (!g_clock.offset_at(t3, &off)) return;
+  const int64_t capture = (int64_t)res.timestamp_ns();
+  lat->capture_to_send_ns   = t0 - capture;
+  lat->uplink_ns            = (t1 - off) - t0;
+  lat->server_wait_ns       = ti - t1;
+  lat->server_processing_ns = t2 - ti;
+  lat->downlink_ns          = t3 - (t2 - off);
+  lat->total_ns             = t3 - capture;
+  lat->valid = 1;
+}
+
+// A result owned by the dispatch stage; view() lends it out as AIV_Result.
+struct OwnedResult {
+  std::string image_id;
+  int64_t frame_index{0};
+  double timestamp_sec{0.0};
+  std::vector<AIV_Detection> dets;
+  AIV_FrameLatency latency{};
+  uint32_t config_version{0};
+
+  AIV_Result view() const {
+    AIV_Result r{};
+    r.image_id = image_id.c_str();
+    r.frame_index = frame_index;
+    r.timestamp_sec = timestamp_sec;
+    r.detections = dets.empty() ? nullptr : dets.data();
+    r.detection_count = (int32_t)dets.size();
+    r.latency = latency;
+    r.config_version = config_version;
+    return r;
+  }
+};
+
+// Triple buffer with the newest result of one camera. recv_loop fills back()
+// and publishes, the host polls the front; one atomic exchange on each side
+// and neither ever waits for the other.
+class LatestResultSlot {
+public:
+  OwnedResult& back() { return buf_[back_]; }
+
+  void publish() {
+    back_ = state_.exchange((uint8_t)(back_ | kFresh), std::memory_order_acq_rel) & kIndex;
+  }
+
+  // The newest result if one was published since the previous poll.
+  const OwnedResult* poll() {
+    if (!(state_.load(std::memory_order_acquire) & kFresh)) return nullptr;
+    front_ = state_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    return &buf_[front_];
+  }
+
+  void discard() { state_.fetch_and(kIndex, std::memory_order_acq_rel); }
+
+private:
+  static constexpr uint8_t kIndex = 3, kFresh = 4;
+  OwnedResult buf_[3];
+  uint8_t back_{0};               // producer only
+  uint8_t front_{2};              // consumer only
+  std::atomic<uint8_t> state_{1}; // middle index | kFresh
+};
+
+static LatestResultSlot g_poll_slots[2];
+
+// Moves on_result off the gRPC read thread so a slow host callback cannot
+// hold up stream->Read. LATEST keeps one pending result per camera and
+// overwrites it; QUEUE delivers every result in order up to a bound.
+class ResultDispatcher {
+public:
+  void start(int32_t mode) {
+    mode_ = mode;
+    coalesced_ = dropped_ = 0;
+    if (mode_ == AIV_DISPATCH_INLINE) return;
+    stop_ = false;
+    th_ = std::thread(&ResultDispatcher::run, this);
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (th_.joinable()) th_.join();
+    pending_[0] = pending_[1] = false;
+    q_.clear();
+    if (coalesced_ || dropped_)
+      LOGI("dispatch: coalesced=%llu dropped=%llu",
+           (unsigned long long)coalesced_, (unsigned long long)dropped_);
+  }
+
+  // recv_loop only. In LATEST mode r is swapped with the slot so its buffers
+  // come back for reuse.
+  void post(AIV_CamRole role, OwnedResult& r) {
+    if (mode_ == AIV_DISPATCH_INLINE) {
+      if (g_on_result) { AIV_Result v = r.view(); g_on_result(&v); }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (mode_ == AIV_DISPATCH_LATEST) {
+        const int i = (role == AIV_CAM_RIGHT) ? 1 : 0;
+        if (pending_[i]) coalesced_++;
+        std::swap(latest_[i], r);
+        pending_[i] = true;
+      } else {
+        if (q_.size() >= kMaxQueued) { q_.pop_front(); dropped_++; }
+        q_.push_back(r);
+      }
+    }
+    cv_.notify_one();
+  }
+
+private:
+  static constexpr size_t kMaxQueued = 64;
+
+  void run() {
+    OwnedResult cur;
+    int turn = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&]{ return stop_ || pending_[0] || pending_[1] || !q_.empty(); });
+        if (stop_) break;
+        if (mode_ == AIV_DISPATCH_LATEST) {
+          // Alternate so one busy camera cannot starve the other.
+          const int i = pending_[turn & 1] ? (turn & 1) : ((turn + 1) & 1);
+          std::swap(cur, latest_[i]);
+          pending_[i] = false;
+          turn++;
+        } else {
+          std::swap(cur, q_.front());
+          q_.pop_front();
+        }
+      }
+      if (g_on_result) { AIV_Result v = cur.view(); g_on_result(&v); }
+    }
+  }
+
+  int32_t mode_{AIV_DISPATCH_LATEST};
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::thread th_;
+  bool stop_{false};
+  OwnedResult latest_[2];
+  bool pending_[2]{false, false};
+  std::deque<OwnedResult> q_;
+  uint64_t coalesced_{0}, dropped_{0};
+};
+
+static ResultDispatcher g_dispatch;
+static std::atomic<int32_t> g_dispatch_mode{AIV_DISPATCH_LATEST};
+
+// Reads until the server ends the call. Results that arrive after stop are
+// drained without delivery: Finish() blocks while any are left unread.
+static void recv_loop(Link* link) {
+  OwnedResult out;
+  for (;;) {
     vision::Result res;
 
     grpc::ClientReaderWriter<vision::Frame, vision::Result>* stream = nullptr;
+    grpc::ClientReaderWriter<vision::FrameBatch, vision::Result>* batch_stream = nullptr;
     {
-      std::lock_guard<std::mutex> lk(g_stream_mu);
-      if (!g_stream) break;
-      stream = g_stream.get();
+      std::lock_guard<std::mutex> lk(link->mu);
+      stream = link->stream.get();
+      batch_stream = link->batch_stream.get();
+    }
+    if (!stream && !batch_stream) break;
+
+    if (!(stream ? stream->Read(&res) : batch_stream->Read(&res))) break;
+    if (!g_running.load()) continue;
+    const int64_t recv_ns = AIV_GetElapsedRealtimeNanos();
+    if (!g_startup.first_result.load(std::memory_order_relaxed)) {
+      g_startup.mark(g_startup.first_result);
+      LOGI("startup: first result after %.1f ms", g_startup.first_result.load() * 1e-6);
     }
 
-    if (!stream->Read(&res)) break;
+    CamContext* cc = cam_for_stream_id(res.stream_id());
+    if (g_recorder.active()) g_recorder.add_result(cc->role, res, recv_ns);
 
-    static thread_local std::vector<AIV_Detection> detbuf;
-    detbuf.clear(); detbuf.reserve(res.detections_size());
-    for (int i = 0; i < res.detections_size(); ++i) {
-      const auto& d = res.detections(i);
-      if (d.score() < g_score_thresh) continue;
-      AIV_Detection ad{};
-      ad.box.x = d.box().x();
-      ad.box.y = d.box().y();
-      ad.box.w = d.box().w();
-      ad.box.h = d.box().h();
-      ad.class_id = d.class_id();
-      ad.score = d.score();
-      detbuf.push_back(ad);
-    }
+    const float thresh = g_live.load().score_threshold;
+    std::vector<AIV_Detection>& detbuf = out.dets;
+    if (res.has_packed()) unpack_detections(res.packed(), thresh, detbuf);
+    else copy_detections(res, thresh, detbuf);
+
+    cc->tracker.update(
+        detbuf.data(), (int)detbuf.size(), res.timestamp_ns(), get_tracker_cfg());
 
     char idbuf[128];
     std::snprintf(idbuf, sizeof(idbuf), "%s_%llu", res.stream_id().c_str(), (unsigned long long)res.frame_index());
-    AIV_Result r{};
-    r.image_id = idbuf;
-    r.frame_index = (int64_t)res.frame_index();
-    r.timestamp_sec = (double)res.timestamp_ns() * 1e-9;
-    r.detections = detbuf.empty() ? nullptr : detbuf.data();
-    r.detection_count = (int32_t)detbuf.size();
-    if (g_on_result) g_on_result(&r);
+    out.image_id.assign(idbuf);
+    out.frame_index = (int64_t)res.frame_index();
+    out.timestamp_sec = (double)res.timestamp_ns() * 1e-9;
+    fill_latency(res, recv_ns, &out.latency);
+    out.config_version = res.config_version();
+
+    LatestResultSlot& slot = g_poll_slots[cc->role == AIV_CAM_RIGHT ? 1 : 0];
+    slot.back() = out;
+    slot.publish();
+    g_dispatch.post(cc->role, out);
   }
 }
 
+static constexpr int kConnectTimeoutMs = 5000;
+
+// Channels connect lazily and only make progress while someone waits on
+// them, so AIV_Init starts the TCP/HTTP2 handshake on a short-lived thread
+// and the first frames do not pay for it. The thread is detached and owns
+// its channel references, so a host that never calls AIV_Shutdown is not
+// left with a joinable std::thread at exit.
+static std::shared_ptr<std::atomic<int>> g_prewarm_stop;
+
+static void stop_prewarm() {
+  if (g_prewarm_stop) g_prewarm_stop->store(1);
+  g_prewarm_stop.reset();
+}
+
+static void start_prewarm() {
+  stop_prewarm();
+  auto stop = std::make_shared<std::atomic<int>>(0);
+  g_prewarm_stop = stop;
+  std::vector<std::shared_ptr<grpc::Channel>> chans;
+  for (int i = 0; i < links_for_mode(g_conn_mode.load()); ++i)
+    if (g_links[i].channel) chans.push_back(g_links[i].channel);
+  std::thread([chans, stop] {
+    for (const auto& ch : chans) ch->GetState(true);
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(kConnectTimeoutMs);
+    for (const auto& ch : chans) {
+      while (!stop->load() && std::chrono::steady_clock::now() < end) {
+        if (ch->WaitForConnected(std::chrono::system_clock::now() + std::chrono::milliseconds(100))) break;
+      }
+    }
+  }).detach();
+}
+
 AIV_Status AIV_Init(const char* grpc_target) {
   if (!grpc_target) return AIV_ERR_INVALID_ARG;
   if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
 
   g_target = grpc_target;
   try {
-    grpc::ChannelArguments args;
-    args.SetInt(GRPC_ARG_MAX_RECEIVE_MESSAGE_LENGTH, 32 * 1024 * 1024);
-    args.SetInt(GRPC_ARG_MAX_SEND_MESSAGE_LENGTH, 32 * 1024 * 1024);
-    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, 15000);
-    args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, 5000);
-    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
-    args.SetCompressionAlgorithm(GRPC_COMPRESS_NONE);
-    g_channel = grpc::CreateCustomChannel(g_target, grpc::InsecureChannelCredentials(), args);
-    g_stub = vision::Vision::NewStub(g_channel);
+    for (int i = 0; i < 2; ++i) {
+      grpc::ChannelArguments args;
+      args.SetInt(GRPC_ARG_MAX_RECEIVE_MESSAGE_LENGTH, 32 * 1024 * 1024);
+      args.SetInt(GRPC_ARG_MAX_SEND_MESSAGE_LENGTH, 32 * 1024 * 1024);
+      args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, 15000);
+      args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, 5000);
+      args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+      args.SetCompressionAlgorithm(GRPC_COMPRESS_NONE);
+      // Channels with equal args to the same target share one subchannel,
+      // i.e. one TCP connection; a private pool and a distinct arg keep
+      // the links apart. Link 1 stays idle unless PER_STREAM is used.
+      args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+      args.SetInt("aiv.link", i);
+      g_links[i].channel = grpc::CreateCustomChannel(g_target, grpc::InsecureChannelCredentials(), args);
+      g_links[i].stub = vision::Vision::NewStub(g_links[i].channel);
+    }
+    start_prewarm();
   } catch (...) {
     if (g_on_error) g_on_error(AIV_ERR_GRPC, "Failed to initialize gRPC channel/stub.");
     return AIV_ERR_GRPC;
@@ -555,9 +1976,13 @@ AIV_Status AIV_Init(const char* grpc_target) {
 
 void AIV_Shutdown(void) {
   AIV_StopStreaming();
+  stop_prewarm();
+  g_recorder.stop();
   g_target.clear();
-  g_stub.reset();
-  g_channel.reset();
+  for (Link& l : g_links) {
+    l.stub.reset();
+    l.channel.reset();
+  }
 #if defined(__ANDROID__)
   if (g_mgr) { ACameraManager_delete(g_mgr); g_mgr = nullptr; }
 #endif
@@ -569,15 +1994,108 @@ void AIV_SetCallbacks(AIV_OnResult on_result, AIV_OnError on_error, AIV_OnFrameS
   g_on_frame_sent = on_frame_sent;
 }
 
+AIV_Status AIV_SetLiveConfig(const AIV_LiveConfig* cfg) {
+  if (!cfg) return AIV_ERR_INVALID_ARG;
+  AIV_LiveConfig c = *cfg;
+  clamp_jpeg_cfg(c.jpeg);
+  if (!clamp_stream_policy(c.stream[0]) || !clamp_stream_policy(c.stream[1])) return AIV_ERR_INVALID_ARG;
+  g_live.update([&](AIV_LiveConfig& v) {
+    const uint32_t version = v.version + 1;
+    v = c;
+    v.version = version;
+  });
+  return AIV_OK;
+}
+void AIV_GetLiveConfig(AIV_LiveConfig* out) { if (out) *out = g_live.load(); }
+
 AIV_Status AIV_SetJpegConfig(const AIV_JpegConfig* cfg) {
   if (!cfg) return AIV_ERR_INVALID_ARG;
-  g_jpeg_cfg = *cfg;
-  clamp_jpeg_cfg(g_jpeg_cfg);
+  AIV_JpegConfig c = *cfg;
+  clamp_jpeg_cfg(c);
+  g_live.update([&](AIV_LiveConfig& v) { v.jpeg = c; v.version++; });
+  return AIV_OK;
+}
+void AIV_GetJpegConfig(AIV_JpegConfig* out) { if (out) *out = g_live.load().jpeg; }
+
+AIV_Status AIV_SetScoreThreshold(float score_threshold) {
+  g_live.update([&](AIV_LiveConfig& v) { v.score_threshold = score_threshold; v.version++; });
+  return AIV_OK;
+}
+AIV_Status AIV_SetVideoConfig(const AIV_VideoConfig* cfg) {
+  if (!cfg) return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  if (cfg->codec != AIV_CODEC_JPEG && cfg->codec != AIV_CODEC_H264 && cfg->codec != AIV_CODEC_RAW)
+    return AIV_ERR_INVALID_ARG;
+#if !defined(AIV_HAVE_OPENH264)
+  if (cfg->codec == AIV_CODEC_H264) return AIV_ERR_INVALID_ARG;
+#endif
+  AIV_VideoConfig c = *cfg;
+  if (c.bitrate_kbps <= 0)      c.bitrate_kbps = 2000;
+  if (c.keyframe_interval <= 0) c.keyframe_interval = 30;
+  g_video_cfg = c;
+  return AIV_OK;
+}
+void AIV_GetVideoConfig(AIV_VideoConfig* out) { if (out) *out = g_video_cfg; }
+
+AIV_Status AIV_SetBatchConfig(const AIV_BatchConfig* cfg) {
+  if (!cfg) return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  AIV_BatchConfig c = *cfg;
+  if (c.max_frames < 1)    c.max_frames = 1;
+  if (c.max_bytes <= 0)    c.max_bytes = 256 * 1024;
+  if (c.max_delay_us < 0)  c.max_delay_us = 0;
+  g_batch_cfg = c;
+  return AIV_OK;
+}
+void AIV_GetBatchConfig(AIV_BatchConfig* out) { if (out) *out = g_batch_cfg; }
+
+AIV_Status AIV_SetSliceCount(int32_t slices) {
+  if (slices < 1 || slices > 16) return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  g_slice_count.store(slices);
+  return AIV_OK;
+}
+
+AIV_Status AIV_SetResultEncoding(int role, int32_t encoding) {
+  if (encoding != AIV_RESULT_DETECTIONS && encoding != AIV_RESULT_PACKED) return AIV_ERR_INVALID_ARG;
+  CamContext* cc = (role == AIV_CAM_RIGHT) ? &g_right : &g_left;
+  cc->result_encoding.store(encoding);
+  return AIV_OK;
+}
+
+AIV_Status AIV_SetStreamPolicy(int role, const AIV_StreamPolicy* policy) {
+  if (!policy) return AIV_ERR_INVALID_ARG;
+  AIV_StreamPolicy p = *policy;
+  if (!clamp_stream_policy(p)) return AIV_ERR_INVALID_ARG;
+  const int i = role_index((AIV_CamRole)role);
+  g_live.update([&](AIV_LiveConfig& v) { v.stream[i] = p; v.version++; });
+  return AIV_OK;
+}
+
+AIV_Status AIV_GetStreamPolicy(int role, AIV_StreamPolicy* out) {
+  if (!out) return AIV_ERR_INVALID_ARG;
+  *out = g_live.load().stream[role_index((AIV_CamRole)role)];
+  return AIV_OK;
+}
+
+AIV_Status AIV_SetTrackerConfig(const AIV_TrackerConfig* cfg) {
+  if (!cfg) return AIV_ERR_INVALID_ARG;
+  AIV_TrackerConfig c = *cfg;
+  clamp_tracker_cfg(c);
+  std::lock_guard<std::mutex> lk(g_tracker_cfg_mu);
+  g_tracker_cfg = c;
+  return AIV_OK;
+}
+void AIV_GetTrackerConfig(AIV_TrackerConfig* out) { if (out) *out = get_tracker_cfg(); }
+
+AIV_Status AIV_GetPredictedDetections(int role, int64_t target_time_ns,
+                                      AIV_Detection* out, int32_t capacity, int32_t* out_count) {
+  if (!out_count || capacity < 0 || (capacity > 0 && !out)) return AIV_ERR_INVALID_ARG;
+  CamContext* cc = (role == AIV_CAM_RIGHT) ? &g_right : &g_left;
+  *out_count = cc->tracker.predict(target_time_ns, out, capacity, get_tracker_cfg().max_predict_ns);
   return AIV_OK;
 }
-void AIV_GetJpegConfig(AIV_JpegConfig* out) { if (out) *out = g_jpeg_cfg; }
 
-AIV_Status AIV_SetScoreThreshold(float score_threshold) { g_score_thresh = score_threshold; return AIV_OK; }
 AIV_Status AIV_SetStereoStreamBaseId(const char* base_id) { if (!base_id) return AIV_ERR_INVALID_ARG; g_stream_base = base_id; return AIV_OK; }
 
 #if defined(__ANDROID__)
@@ -643,70 +2161,148 @@ AIV_Status AIV_SetCameraForRole(int role, const char* cam_id, const AIV_CaptureC
   return AIV_OK;
 }
 
-AIV_Status AIV_StartStreamingStereo(void) {
-  if (g_running.exchange(1)) return AIV_ERR_ALREADY_RUNNING;
+static void start_dispatch() {
+  g_poll_slots[0].discard();
+  g_poll_slots[1].discard();
+  g_dispatch.start(g_dispatch_mode.load());
+}
 
-  if ((!g_left.cam_id.size()) && (!g_right.cam_id.size())) {
-    g_running.store(0);
-    return AIV_ERR_INVALID_ARG;
+// Waits for the channels AIV_Init started connecting; bounded so an
+// unreachable server fails the start instead of stalling it.
+static AIV_Status connect_channel() {
+  for (int i = 0; i < g_link_count; ++i)
+    if (!g_links[i].channel) return AIV_ERR_NOT_INITIALIZED;
+  for (int i = 0; i < g_link_count; ++i) g_links[i].channel->GetState(true);
+  const auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(kConnectTimeoutMs);
+  for (int i = 0; i < g_link_count; ++i) {
+    if (!g_links[i].channel->WaitForConnected(deadline)) {
+      if (g_on_error) g_on_error(AIV_ERR_GRPC, "Server not reachable.");
+      return AIV_ERR_GRPC;
+    }
   }
+  g_startup.mark(g_startup.channel_ready);
+  return AIV_OK;
+}
 
-  g_left.raw_q  = std::make_unique<SpscQueue<I420Frame>>(4);
-  g_left.enc_q  = std::make_unique<SpscQueue<EncodedPacket>>(3);
-  g_right.raw_q = std::make_unique<SpscQueue<I420Frame>>(4);
-  g_right.enc_q = std::make_unique<SpscQueue<EncodedPacket>>(3);
+// Tears down streams that never carried frames (failed start).
+static void abort_stream() {
+  for (Link& l : g_links) {
+    std::lock_guard<std::mutex> lk(l.mu);
+    if (l.ctx) l.ctx->TryCancel();
+    if (l.stream) { l.stream->Finish(); l.stream.reset(); }
+    if (l.batch_stream) { l.batch_stream->Finish(); l.batch_stream.reset(); }
+    l.ctx.reset();
+  }
+  g_connected.store(0);
+}
 
+static AIV_Status open_link(Link& l) {
+  if (!l.stub) return AIV_ERR_NOT_INITIALIZED;
+  l.ctx = std::make_unique<grpc::ClientContext>();
+  std::lock_guard<std::mutex> lk(l.mu);
+  bool opened;
+  if (g_batch_cfg.max_frames > 1) {
+    l.batch_stream = l.stub->StreamDetectBatched(l.ctx.get());
+    opened = (bool)l.batch_stream;
+  } else {
+    l.stream = l.stub->StreamDetect(l.ctx.get());
+    opened = (bool)l.stream;
+  }
+  if (!opened) {
+    if (g_on_error) g_on_error(AIV_ERR_GRPC, "Failed to open streaming RPC.");
+    l.ctx.reset();
+    return AIV_ERR_GRPC;
+  }
+  return AIV_OK;
+}
+
+static AIV_Status open_stream() {
   try {
-    g_ctx = std::make_unique<grpc::ClientContext>();
-    {
-      std::lock_guard<std::mutex> lk(g_stream_mu);
-      g_stream = g_stub->StreamDetect(g_ctx.get());
-      if (!g_stream) {
-        if (g_on_error) g_on_error(AIV_ERR_GRPC, "Failed to open streaming RPC.");
-        g_ctx.reset();
-        g_running.store(0);
-        return AIV_ERR_GRPC;
+    for (int i = 0; i < g_link_count; ++i) {
+      const AIV_Status st = open_link(g_links[i]);
+      if (st != AIV_OK) {
+        abort_stream();
+        return st;
       }
     }
     g_connected.store(1);
+    g_startup.mark(g_startup.stream_open);
   } catch (...) {
-    g_running.store(0);
     return AIV_ERR_INTERNAL;
   }
+  return AIV_OK;
+}
 
-#if defined(__ANDROID__)
-  if (g_left.cam_id.size()) {
-    g_left.idx.store(0);
-    LOGI("StartStreamingStereo: opening LEFT id=%s", g_left.cam_id.c_str());
-    if (!open_camera(&g_left)) {
-      LOGE("StartStreamingStereo: failed to open LEFT id=%s", g_left.cam_id.c_str());
-      g_running.store(0);
-      return AIV_ERR_CAMERA_OPEN;
-    }
-    LOGI("StartStreamingStereo: opened LEFT id=%s", g_left.cam_id.c_str());
+// One sender and one receiver per link; a single link's sender serves both
+// cameras.
+static void start_links() {
+  for (int i = 0; i < g_link_count; ++i) {
+    const unsigned cam_mask = (g_link_count > 1) ? (1u << i) : 3u;
+    g_links[i].recv_th = std::thread(recv_loop, &g_links[i]);
+    g_links[i].send_th = std::thread(send_loop, &g_links[i], cam_mask);
   }
+}
 
-  if (g_right.cam_id.size()) {
-    g_right.idx.store(0);
-    LOGI("StartStreamingStereo: opening RIGHT id=%s", g_right.cam_id.c_str());
-    if (!open_camera(&g_right)) {
-      LOGE("StartStreamingStereo: failed to open RIGHT id=%s", g_right.cam_id.c_str());
-      if (g_left.cam_id.size()) close_camera(&g_left);
-      g_running.store(0);
-      return AIV_ERR_CAMERA_OPEN;
-    }
-    LOGI("StartStreamingStereo: opened RIGHT id=%s", g_right.cam_id.c_str());
+AIV_Status AIV_StartStreamingStereo(void) {
+  if (g_running.exchange(1)) return AIV_ERR_ALREADY_RUNNING;
+
+  if ((!g_left.cam_id.size()) && (!g_right.cam_id.size())) {
+    g_running.store(0);
+    return AIV_ERR_INVALID_ARG;
   }
-#else
-  if (g_on_error) g_on_error(AIV_ERR_INTERNAL, "Android-only capture path is not available on this platform.");
-  g_running.store(0);
-  return AIV_ERR_INTERNAL;
-#endif
 
+  g_startup.begin();
+  g_link_count = links_for_mode(g_conn_mode.load());
+  g_left.tracker.reset();
+  g_right.tracker.reset();
+  g_left.send_frame = g_right.send_frame = -1;
+  g_clock.reset();
+
+  // Room for a few frames' worth of slices. A drop takes out a whole frame:
+  // the encoder skips frames that do not fit under drop-newest, and send_loop
+  // discards what is left of a frame whose band drop-oldest evicted. A frame
+  // that loses its tail after its head is on the wire is dropped by the
+  // server when the next frame's first band arrives.
+  const size_t enc_cap = 3 * (size_t)g_slice_count.load();
+  g_left.raw_q  = std::make_unique<SpscQueue<I420Frame>>(4);
+  g_left.enc_q  = std::make_unique<SpscQueue<EncodedPacket>>(enc_cap);
+  g_right.raw_q = std::make_unique<SpscQueue<I420Frame>>(4);
+  g_right.enc_q = std::make_unique<SpscQueue<EncodedPacket>>(enc_cap);
+
+  // Everything that takes a while runs at once: the encode threads warm up,
+  // each camera opens on its own thread, and this thread waits for the
+  // channel and opens the RPC.
   g_left.encode_th  = std::thread(encode_loop, &g_left);
   g_right.encode_th = std::thread(encode_loop, &g_right);
-  g_recv_thread     = std::thread(recv_loop);
-  g_send_thread     = std::thread(send_loop);
+
+  std::atomic<int> cams_ok{1};
+  std::thread cam_th[2];
+  CamContext* cams[2] = {&g_left, &g_right};
+  for (int i = 0; i < 2; ++i) {
+    if (!cams[i]->cam_id.size()) continue;
+    cam_th[i] = std::thread([cc = cams[i], &cams_ok] { if (!start_capture(cc)) cams_ok.store(0); });
+  }
+
+  AIV_Status st = connect_channel();
+  if (st == AIV_OK) st = open_stream();
+
+  for (auto& t : cam_th) if (t.joinable()) t.join();
+  if (st == AIV_OK && !cams_ok.load()) st = AIV_ERR_CAMERA_OPEN;
+
+  if (st != AIV_OK) {
+    g_running.store(0);
+    stop_capture(&g_left);
+    stop_capture(&g_right);
+    if (g_left.encode_th.joinable())  g_left.encode_th.join();
+    if (g_right.encode_th.joinable()) g_right.encode_th.join();
+    abort_stream();
+    g_left.raw_q.reset();  g_left.enc_q.reset();
+    g_right.raw_q.reset(); g_right.enc_q.reset();
+    return st;
+  }
+
+  start_dispatch();
+  start_links();
 
   return AIV_OK;
 }
@@ -714,25 +2310,31 @@ AIV_Status AIV_StartStreamingStereo(void) {
 AIV_Status AIV_StopStreaming(void) {
   if (!g_running.exchange(0)) return AIV_ERR_NOT_RUNNING;
 
-#if defined(__ANDROID__)
-  close_camera(&g_left);
-  close_camera(&g_right);
-#endif
+  stop_capture(&g_left);
+  stop_capture(&g_right);
 
-  if (g_send_thread.joinable()) g_send_thread.join();
-  if (g_recv_thread.joinable()) g_recv_thread.join();
+  if (g_replay_thread.joinable()) g_replay_thread.join();
+  for (Link& l : g_links) if (l.send_th.joinable()) l.send_th.join();
+  for (Link& l : g_links) if (l.recv_th.joinable()) l.recv_th.join();
+  g_dispatch.stop();
 
   if (g_left.encode_th.joinable())  g_left.encode_th.join();
   if (g_right.encode_th.joinable()) g_right.encode_th.join();
 
   grpc::Status status;
-  {
-    std::lock_guard<std::mutex> lk(g_stream_mu);
-    if (g_stream) {
-      status = g_stream->Finish();
-      g_stream.reset();
+  for (Link& l : g_links) {
+    std::lock_guard<std::mutex> lk(l.mu);
+    grpc::Status ls;
+    if (l.stream) {
+      ls = l.stream->Finish();
+      l.stream.reset();
+    }
+    if (l.batch_stream) {
+      ls = l.batch_stream->Finish();
+      l.batch_stream.reset();
     }
-    g_ctx.reset();
+    l.ctx.reset();
+    if (status.ok()) status = ls;
   }
   g_connected.store(0);
 
@@ -745,6 +2347,58 @@ AIV_Status AIV_StopStreaming(void) {
 
 int32_t AIV_IsStreaming(void) { return g_running.load() && g_connected.load(); }
 
+AIV_Status AIV_StartRecording(const char* path) {
+  if (!path || !*path) return AIV_ERR_INVALID_ARG;
+  if (g_recorder.active()) return AIV_ERR_ALREADY_RUNNING;
+  if (!g_recorder.start(path)) {
+    if (g_on_error) g_on_error(AIV_ERR_IO, "Failed to create session log.");
+    return AIV_ERR_IO;
+  }
+  return AIV_OK;
+}
+
+AIV_Status AIV_StopRecording(void) {
+  if (!g_recorder.active()) return AIV_ERR_NOT_RUNNING;
+  g_recorder.stop();
+  return AIV_OK;
+}
+
+int32_t AIV_IsRecording(void) { return g_recorder.active() ? 1 : 0; }
+
+AIV_Status AIV_StartReplay(const char* path, const AIV_ReplayConfig* cfg) {
+  if (!path || !cfg) return AIV_ERR_INVALID_ARG;
+  if (g_running.exchange(1)) return AIV_ERR_ALREADY_RUNNING;
+
+  g_startup.begin();
+  g_link_count = links_for_mode(g_conn_mode.load());
+  g_left.tracker.reset();
+  g_right.tracker.reset();
+  g_left.send_frame = g_right.send_frame = -1;
+  g_clock.reset();
+
+  // Recorded packets are already encoded; they go straight to the sender.
+  g_left.enc_q  = std::make_unique<SpscQueue<EncodedPacket>>(3 * 16);
+  g_right.enc_q = std::make_unique<SpscQueue<EncodedPacket>>(3 * 16);
+
+  AIV_Status st = connect_channel();
+  if (st == AIV_OK) st = open_stream();
+  if (st != AIV_OK) {
+    g_left.enc_q.reset(); g_right.enc_q.reset();
+    g_running.store(0);
+    return st;
+  }
+
+  AIV_ReplayConfig rc = *cfg;
+  if (rc.start_frame < 0) rc.start_frame = 0;
+  g_replaying.store(1);
+  start_dispatch();
+  start_links();
+  g_replay_thread = std::thread(replay_loop, std::string(path), rc);
+  return AIV_OK;
+}
+
+int32_t AIV_IsReplaying(void) { return g_replaying.load(); }
+
 AIV_Status AIV_GetCameraIdByPosition(int32_t position_value, char* out_cam_id, int32_t cap) {
   if (!out_cam_id || cap <= 0) return AIV_ERR_INVALID_ARG;
 
@@ -828,6 +2482,63 @@ AIV_Status AIV_GetCameraParams(const char* cam_id, AIV_Intrinsics* K, AIV_Extrin
 #endif
 }
 
+AIV_Status AIV_SetDispatchMode(int32_t mode) {
+  if (mode != AIV_DISPATCH_INLINE && mode != AIV_DISPATCH_LATEST && mode != AIV_DISPATCH_QUEUE)
+    return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  g_dispatch_mode.store(mode);
+  return AIV_OK;
+}
+
+AIV_Status AIV_SetConnectionMode(int32_t mode) {
+  if (mode != AIV_CONNECTION_SHARED && mode != AIV_CONNECTION_PER_STREAM) return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  if (g_conn_mode.exchange(mode) != mode && g_links[0].channel) start_prewarm();
+  return AIV_OK;
+}
+
+int32_t AIV_GetConnectionMode(void) { return g_conn_mode.load(); }
+
+AIV_Status AIV_SetColorMode(int32_t mode) {
+  if (mode != AIV_COLOR_YUV && mode != AIV_COLOR_GRAY) return AIV_ERR_INVALID_ARG;
+  if (g_running.load()) return AIV_ERR_ALREADY_RUNNING;
+  g_color_mode.store(mode);
+  return AIV_OK;
+}
+
+int32_t AIV_GetColorMode(void) { return g_color_mode.load(); }
+
+int32_t AIV_PollLatestResult(int32_t role, AIV_Result* out, AIV_Detection* dets, int32_t capacity) {
+  if (!out || (role != AIV_CAM_LEFT && role != AIV_CAM_RIGHT)) return 0;
+  const OwnedResult* r = g_poll_slots[role == AIV_CAM_RIGHT ? 1 : 0].poll();
+  if (!r) return 0;
+  *out = r->view();
+  const int32_t n = (dets && capacity > 0) ? std::min<int32_t>(capacity, out->detection_count) : 0;
+  if (n) std::memcpy(dets, r->dets.data(), sizeof(AIV_Detection) * (size_t)n);
+  out->detections = n ? dets : nullptr;
+  out->detection_count = n;
+  return 1;
+}
+
+AIV_Status AIV_GetStartupStats(AIV_StartupStats* out) {
+  if (!out) return AIV_ERR_INVALID_ARG;
+  out->channel_ready_ns  = g_startup.channel_ready.load();
+  out->stream_open_ns    = g_startup.stream_open.load();
+  out->camera_open_ns[0] = g_startup.camera_open[0].load();
+  out->camera_open_ns[1] = g_startup.camera_open[1].load();
+  out->encoder_ready_ns  = g_startup.encoder_ready.load();
+  out->first_frame_ns    = g_startup.first_frame.load();
+  out->first_send_ns     = g_startup.first_send.load();
+  out->first_result_ns   = g_startup.first_result.load();
+  return g_startup.t0.load() ? AIV_OK : AIV_ERR_NOT_RUNNING;
+}
+
+AIV_Status AIV_GetClockSync(AIV_ClockSync* out) {
+  if (!out) return AIV_ERR_INVALID_ARG;
+  *out = g_clock.get(AIV_GetElapsedRealtimeNanos());
+  return out->samples > 0 ? AIV_OK : AIV_ERR_NOT_RUNNING;
+}
+
 int64_t AIV_GetElapsedRealtimeNanos() {
     struct timespec ts;
     if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
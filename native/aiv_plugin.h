@@ -34,6 +34,19 @@ typedef struct {
   int32_t fps;
 } AIV_CaptureConfig;
 
+typedef enum {
+  AIV_DROP_OLDEST = 0, // full queue: replace the oldest waiting frame (default)
+  AIV_DROP_NEWEST = 1  // full queue: discard the incoming frame
+} AIV_DropPolicy;
+
+// Per-camera send scheduling. Frames over max_fps are skipped as they come
+// off the camera, before conversion and encoding.
+typedef struct {
+  float   max_fps;     // <= 0 = every captured frame (default)
+  int32_t priority;    // share of send turns when both cameras have data queued (>= 1, default 1)
+  int32_t drop_policy; // AIV_DropPolicy for the capture and send queues (H.264 sends drop newest)
+} AIV_StreamPolicy;
+
 typedef struct {
   float x;
   float y;
@@ -47,14 +60,53 @@ typedef struct {
   float score;
 } AIV_Detection;
 
+// Per-frame latency split, all in the headset clock. Server timestamps are
+// mapped through the current clock-offset estimate; valid = 0 until the
+// server has echoed timestamps back.
+typedef struct {
+  int64_t capture_to_send_ns;
+  int64_t uplink_ns;
+  int64_t server_wait_ns;        // receive -> inference start (incl. decode)
+  int64_t server_processing_ns;  // inference start -> send
+  int64_t downlink_ns;
+  int64_t total_ns;              // capture -> result received
+  int32_t valid;
+} AIV_FrameLatency;
+
 typedef struct {
   const char* image_id;
   int64_t frame_index;
   double timestamp_sec;
   const AIV_Detection* detections;
   int32_t detection_count;
+  AIV_FrameLatency latency;
+  uint32_t config_version;  // AIV_LiveConfig.version the frame was encoded under
 } AIV_Result;
 
+typedef struct {
+  int64_t offset_ns;   // server clock - headset clock, at the time of the call
+  double  drift_ppm;   // rate of change of offset
+  int64_t min_rtt_ns;  // network round trip of the best recent sample
+  int32_t samples;     // samples in the estimation window
+} AIV_ClockSync;
+
+// Startup timeline of the last session, in ns since AIV_StartStreamingStereo
+// (or AIV_StartReplay) was called; 0 = not reached yet.
+typedef struct {
+  int64_t channel_ready_ns;   // connected (immediate if AIV_Init's pre-connect finished)
+  int64_t stream_open_ns;
+  int64_t camera_open_ns[2];  // indexed by AIV_CamRole
+  int64_t encoder_ready_ns;   // last encode thread done warming up
+  int64_t first_frame_ns;     // first captured frame queued for encoding
+  int64_t first_send_ns;
+  int64_t first_result_ns;    // time to first result
+} AIV_StartupStats;
+
+typedef enum {
+  AIV_RESULT_DETECTIONS = 0, // one nested message per detection
+  AIV_RESULT_PACKED     = 1  // parallel packed arrays
+} AIV_ResultEncoding;
+
 typedef enum {
   AIV_OK = 0,
   AIV_ERR_INVALID_ARG     = -1,
@@ -64,6 +116,7 @@ typedef enum {
   AIV_ERR_CAMERA_OPEN     = -5,
   AIV_ERR_CAMERA_PARAM    = -6,
   AIV_ERR_GRPC            = -7,
+  AIV_ERR_IO              = -8,
   AIV_ERR_INTERNAL        = -9
 } AIV_Status;
 
@@ -75,6 +128,83 @@ typedef struct {
   int32_t jpeg_quality;
 } AIV_JpegConfig;
 
+// Settings that apply from the next frame (or result) while streaming. They
+// are swapped as one snapshot; every change bumps version, and each Frame and
+// AIV_Result carries the version it was produced under.
+typedef struct {
+  AIV_JpegConfig   jpeg;            // quality and output size
+  float            score_threshold;
+  AIV_StreamPolicy stream[2];       // indexed by AIV_CamRole
+  uint32_t         version;         // ignored by AIV_SetLiveConfig
+} AIV_LiveConfig;
+
+typedef struct {
+  // Minimum IoU between a track's predicted box and a detection of the
+  // same class for them to be associated (default 0.3)
+  float   iou_threshold;
+  // 0..1 weight of the newest velocity sample (default 0.5)
+  float   velocity_smoothing;
+  // Tracks not matched for longer than this are dropped (default 500 ms)
+  int64_t max_age_ns;
+  // Upper bound on how far boxes are extrapolated (default 200 ms)
+  int64_t max_predict_ns;
+} AIV_TrackerConfig;
+
+typedef struct {
+  // 0 = pace frames as originally sent, 1 = send as fast as the sender drains
+  int32_t max_speed;
+  // First/last frame_index to replay; end_frame < 0 = until end of log.
+  // H.264 replay starts at the last keyframe at or before start_frame.
+  int64_t start_frame;
+  int64_t end_frame;
+} AIV_ReplayConfig;
+
+typedef enum {
+  AIV_CODEC_JPEG = 0, // independent JPEG per frame
+  AIV_CODEC_H264 = 1, // software H.264 (needs a build with openh264)
+  AIV_CODEC_RAW  = 2  // uncompressed planes: I420, or just luma with AIV_COLOR_GRAY
+} AIV_VideoCodec;
+
+// Pixels captured per frame. GRAY copies only the Y plane from the camera
+// and skips chroma conversion; JPEG is then single-component and RAW sends
+// IMAGE_FORMAT_GRAY8. H.264 gets neutral chroma.
+typedef enum {
+  AIV_COLOR_YUV  = 0, // default
+  AIV_COLOR_GRAY = 1
+} AIV_ColorMode;
+
+typedef struct {
+  int32_t codec;             // AIV_VideoCodec
+  int32_t bitrate_kbps;      // H.264 target bitrate (default 2000)
+  int32_t keyframe_interval; // frames between IDRs (default 30)
+} AIV_VideoConfig;
+
+// Batched uplink: several frames per message on StreamDetectBatched. A batch
+// goes out once it holds max_frames frames or max_bytes of payload, or its
+// oldest frame has waited max_delay_us. max_frames <= 1 (default) sends each
+// frame on its own over StreamDetect.
+typedef struct {
+  int32_t max_frames;
+  int32_t max_bytes;     // default 256 KiB
+  int32_t max_delay_us;  // default 5000
+} AIV_BatchConfig;
+
+typedef enum {
+  AIV_DISPATCH_INLINE = 0, // on_result runs on the gRPC read thread
+  AIV_DISPATCH_LATEST = 1, // dispatch thread, only the newest pending result per camera (default)
+  AIV_DISPATCH_QUEUE  = 2  // dispatch thread, every result in order; oldest dropped past 64 pending
+} AIV_DispatchMode;
+
+// Connections to the server. SHARED runs both cameras over one HTTP/2
+// connection and one call. PER_STREAM gives each camera its own connection,
+// call, send thread and receive thread. A large frame or a TCP loss stall on
+// one eye then does not hold up the other. Callbacks may then arrive from
+// two threads at once.
+typedef enum {
+  AIV_CONNECTION_SHARED     = 0, // default
+  AIV_CONNECTION_PER_STREAM = 1
+} AIV_ConnectionMode;
+
 typedef void (*AIV_OnResult)(const AIV_Result* result);
 typedef void (*AIV_OnError)(int32_t code, const char* message);
 typedef void (*AIV_OnFrameSent)(const char* image_id, int64_t frame_index, double timestamp_sec);
@@ -86,9 +216,27 @@ void       AIV_SetCallbacks(AIV_OnResult on_result,
                             AIV_OnError on_error,
                             AIV_OnFrameSent on_frame_sent);
 
+AIV_Status AIV_SetLiveConfig(const AIV_LiveConfig* cfg);
+void       AIV_GetLiveConfig(AIV_LiveConfig* out);
+
+// Shorthands that change one part of the live config.
 AIV_Status AIV_SetJpegConfig(const AIV_JpegConfig* cfg);
 void       AIV_GetJpegConfig(AIV_JpegConfig* out);
 
+// Transport codec; only while not streaming. Slicing applies to JPEG only.
+AIV_Status AIV_SetVideoConfig(const AIV_VideoConfig* cfg);
+void       AIV_GetVideoConfig(AIV_VideoConfig* out);
+
+// Only while not streaming.
+AIV_Status AIV_SetBatchConfig(const AIV_BatchConfig* cfg);
+void       AIV_GetBatchConfig(AIV_BatchConfig* out);
+
+// Split each frame into this many horizontal bands (1..16, default 1), each
+// encoded and sent as soon as it is ready so transmission overlaps encoding.
+// This saves up to the encode time of all but the last band; a stream whose
+// latency is dominated by the link gains nothing.
+AIV_Status AIV_SetSliceCount(int32_t slices);
+
 AIV_Status AIV_EnumerateCameras(char* out_json, int32_t capacity);
 
 AIV_Status AIV_GetCameraIdByPosition(int32_t position_value, char* out_cam_id, int32_t cap);
@@ -98,16 +246,66 @@ AIV_Status AIV_GetCameraParams(const char* cam_id,
                                AIV_Rect* A);
 
 AIV_Status AIV_SetScoreThreshold(float score_threshold);
+AIV_Status AIV_SetResultEncoding(int role /* AIV_CamRole */,
+                                 int32_t encoding /* AIV_ResultEncoding */);
+
+// May be changed while streaming.
+AIV_Status AIV_SetStreamPolicy(int role /* AIV_CamRole */, const AIV_StreamPolicy* policy);
+AIV_Status AIV_GetStreamPolicy(int role /* AIV_CamRole */, AIV_StreamPolicy* out);
+
+AIV_Status AIV_SetTrackerConfig(const AIV_TrackerConfig* cfg);
+void       AIV_GetTrackerConfig(AIV_TrackerConfig* out);
+
+// Boxes of the objects seen in the latest result of the role's stream,
+// extrapolated to target_time_ns (same clock as Frame.timestamp_ns).
+AIV_Status AIV_GetPredictedDetections(int role /* AIV_CamRole */,
+                                      int64_t target_time_ns,
+                                      AIV_Detection* out,
+                                      int32_t capacity,
+                                      int32_t* out_count);
 
 AIV_Status AIV_SetStereoStreamBaseId(const char* base_id);
 AIV_Status AIV_SetCameraForRole(int role /* AIV_CamRole */,
                                 const char* cam_id,
                                 const AIV_CaptureConfig* config);
 
+// Connects, opens the RPC and opens both cameras concurrently. Off Android
+// the cameras are synthetic pattern sources at the configured size and rate.
 AIV_Status AIV_StartStreamingStereo(void);
 AIV_Status AIV_StopStreaming(void);
 int32_t    AIV_IsStreaming(void);
 
+// Session log: <path> holds the records, <path>.idx the per-frame index.
+AIV_Status AIV_StartRecording(const char* path);
+AIV_Status AIV_StopRecording(void);
+int32_t    AIV_IsRecording(void);
+
+// Streams the packets of a recorded session instead of the cameras.
+// Stop with AIV_StopStreaming.
+AIV_Status AIV_StartReplay(const char* path, const AIV_ReplayConfig* cfg);
+int32_t    AIV_IsReplaying(void);
+
+AIV_Status AIV_GetStartupStats(AIV_StartupStats* out);
+
+AIV_Status AIV_GetClockSync(AIV_ClockSync* out);
+
+// How on_result is delivered; only while not streaming.
+AIV_Status AIV_SetDispatchMode(int32_t mode);
+
+// Only while not streaming; takes effect on the next start.
+AIV_Status AIV_SetConnectionMode(int32_t mode);
+int32_t    AIV_GetConnectionMode(void);
+
+// Only while not streaming.
+AIV_Status AIV_SetColorMode(int32_t mode);
+int32_t    AIV_GetColorMode(void);
+
+// Newest result of a camera since the previous poll, independent of the
+// dispatch mode and lock-free (call from a single thread). Up to capacity
+// detections are copied into dets; out->image_id stays valid until the next
+// poll for the same role. Returns 1 if out was filled, 0 if nothing new.
+int32_t    AIV_PollLatestResult(int32_t role, AIV_Result* out, AIV_Detection* dets, int32_t capacity);
+
 int64_t    AIV_GetElapsedRealtimeNanos();
 
 #ifdef __cplusplus
@@ -0,0 +1,133 @@
+#pragma once
+
+// Per-stream box tracker. Pure logic, kept out of aiv_plugin.cpp so it can be
+// unit tested on the host without the camera, codec and gRPC dependencies.
+
+#include "aiv_plugin.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Associates detections across results of one stream (greedy IoU matching
+// within a class) and keeps a smoothed velocity per object so that boxes can
+// be extrapolated from the capture time of the last result to display time.
+// Boxes are normalized center/size, as produced by the server.
+class BoxTracker {
+public:
+  void reset() {
+    std::lock_guard<std::mutex> lk(mu_);
+    tracks_.clear();
+    last_ts_ns_ = 0;
+  }
+
+  void update(const AIV_Detection* dets, int n, uint64_t ts_ns, const AIV_TrackerConfig& cfg) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (last_ts_ns_ != 0 && ts_ns <= last_ts_ns_) return; // stale / out of order
+    last_ts_ns_ = ts_ns;
+
+    struct Pair { float iou; int t; int d; };
+    std::vector<Pair> pairs;
+    for (int t = 0; t < (int)tracks_.size(); ++t) {
+      const Track& tr = tracks_[t];
+      const AIV_Box pred = extrapolate(tr, ts_ns, cfg.max_predict_ns);
+      for (int d = 0; d < n; ++d) {
+        if (dets[d].class_id != tr.class_id) continue;
+        const float v = iou(pred, dets[d].box);
+        if (v >= cfg.iou_threshold) pairs.push_back({v, t, d});
+      }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+
+    std::vector<char> t_used(tracks_.size(), 0), d_used(n, 0);
+    for (const Pair& p : pairs) {
+      if (t_used[p.t] || d_used[p.d]) continue;
+      t_used[p.t] = d_used[p.d] = 1;
+
+      Track& tr = tracks_[p.t];
+      const AIV_Box& b = dets[p.d].box;
+      const double dt = (double)(ts_ns - tr.ts_ns) * 1e-9;
+      if (dt > 0.0) {
+        const float a = (tr.hits > 1) ? cfg.velocity_smoothing : 1.0f;
+        tr.v.x = a * (float)((b.x - tr.box.x) / dt) + (1.0f - a) * tr.v.x;
+        tr.v.y = a * (float)((b.y - tr.box.y) / dt) + (1.0f - a) * tr.v.y;
+        tr.v.w = a * (float)((b.w - tr.box.w) / dt) + (1.0f - a) * tr.v.w;
+        tr.v.h = a * (float)((b.h - tr.box.h) / dt) + (1.0f - a) * tr.v.h;
+      }
+      tr.box = b;
+      tr.score = dets[p.d].score;
+      tr.ts_ns = ts_ns;
+      tr.hits++;
+    }
+
+    size_t w = 0;
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+      if (!t_used[t] && (int64_t)(ts_ns - tracks_[t].ts_ns) > cfg.max_age_ns) continue;
+      tracks_[w++] = tracks_[t];
+    }
+    tracks_.resize(w);
+
+    for (int d = 0; d < n; ++d) {
+      if (d_used[d]) continue;
+      Track tr;
+      tr.class_id = dets[d].class_id;
+      tr.score = dets[d].score;
+      tr.box = dets[d].box;
+      tr.ts_ns = ts_ns;
+      tracks_.push_back(tr);
+    }
+  }
+
+  // Only tracks matched in the latest result are reported; coasting tracks
+  // are kept for re-association but not drawn.
+  int predict(int64_t target_ns, AIV_Detection* out, int cap, int64_t max_predict_ns) {
+    std::lock_guard<std::mutex> lk(mu_);
+    int n = 0;
+    for (const Track& tr : tracks_) {
+      if (tr.ts_ns != last_ts_ns_) continue;
+      if (n >= cap) break;
+      AIV_Detection& d = out[n++];
+      d.box = extrapolate(tr, (uint64_t)(target_ns < 0 ? 0 : target_ns), max_predict_ns);
+      d.class_id = tr.class_id;
+      d.score = tr.score;
+    }
+    return n;
+  }
+
+private:
+  struct Track {
+    int32_t class_id{0};
+    float score{0.0f};
+    AIV_Box box{0, 0, 0, 0};  // at ts_ns
+    AIV_Box v{0, 0, 0, 0};    // per second
+    uint64_t ts_ns{0};
+    int hits{1};
+  };
+
+  static AIV_Box extrapolate(const Track& tr, uint64_t ts_ns, int64_t max_ns) {
+    int64_t dns = (int64_t)(ts_ns - tr.ts_ns);
+    if (dns < 0) dns = 0;
+    if (dns > max_ns) dns = max_ns;
+    const float dt = (float)((double)dns * 1e-9);
+    AIV_Box b;
+    b.x = tr.box.x + tr.v.x * dt;
+    b.y = tr.box.y + tr.v.y * dt;
+    b.w = std::max(0.0f, tr.box.w + tr.v.w * dt);
+    b.h = std::max(0.0f, tr.box.h + tr.v.h * dt);
+    return b;
+  }
+
+  static float iou(const AIV_Box& a, const AIV_Box& b) {
+    const float ix = std::min(a.x + a.w * 0.5f, b.x + b.w * 0.5f) - std::max(a.x - a.w * 0.5f, b.x - b.w * 0.5f);
+    const float iy = std::min(a.y + a.h * 0.5f, b.y + b.h * 0.5f) - std::max(a.y - a.h * 0.5f, b.y - b.h * 0.5f);
+    if (ix <= 0.0f || iy <= 0.0f) return 0.0f;
+    const float inter = ix * iy;
+    const float uni = a.w * a.h + b.w * b.h - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+  }
+
+  std::mutex mu_;
+  std::vector<Track> tracks_;
+  uint64_t last_ts_ns_{0};
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// Result payload to AIV_Detection for both result encodings. Kept out of
+// aiv_plugin.cpp so the two paths can be benchmarked on the host with only
+// protobuf (tests/result_unpack_bench.cpp).
+
+#include "aiv_plugin.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <vision.pb.h>
+
+// Packed arrays straight into AIV_Detection. Every entry is written and the
+// output cursor advances only when it passes the threshold, so the loop has no
+// data-dependent branch. It stays scalar: the compacting store keeps the
+// compiler from vectorizing it.
+static inline void unpack_detections(const vision::PackedDetections& p, float thresh,
+                                     std::vector<AIV_Detection>& out) {
+  const int n = std::min({p.boxes_size() / 4, p.scores_size(), p.class_ids_size()});
+  out.resize(n);
+  const float* b = p.boxes().data();
+  const float* s = p.scores().data();
+  const uint32_t* c = p.class_ids().data();
+  AIV_Detection* o = out.data();
+  int k = 0;
+  for (int i = 0; i < n; ++i) {
+    o[k].box.x = b[4 * i + 0];
+    o[k].box.y = b[4 * i + 1];
+    o[k].box.w = b[4 * i + 2];
+    o[k].box.h = b[4 * i + 3];
+    o[k].class_id = (int32_t)c[i];
+    o[k].score = s[i];
+    k += (s[i] >= thresh) ? 1 : 0;
+  }
+  out.resize(k);
+}
+
+// One Detection message at a time, for results sent without packing.
+static inline void copy_detections(const vision::Result& res, float thresh,
+                                   std::vector<AIV_Detection>& out) {
+  out.clear();
+  out.reserve(res.detections_size());
+  for (int i = 0; i < res.detections_size(); ++i) {
+    const auto& d = res.detections(i);
+    if (d.score() < thresh) continue;
+    AIV_Detection ad{};
+    ad.box.x = d.box().x();
+    ad.box.y = d.box().y();
+    ad.box.w = d.box().w();
+    ad.box.h = d.box().h();
+    ad.class_id = d.class_id();
+    ad.score = d.score();
+    out.push_back(ad);
+  }
+}
@@ -0,0 +1,88 @@
+// Bytes on the wire and parse + convert time of one Result with 100
+// detections, packed vs nested. Fails if the two paths disagree.
+#include "result_unpack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+static constexpr int kDetections = 100;
+static constexpr int kIters = 20000;
+static constexpr int kRuns = 7;
+static constexpr float kThresh = 0.5f;
+
+static void make_results(vision::Result& packed, vision::Result& nested) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  for (vision::Result* r : {&packed, &nested}) {
+    r->set_stream_id("bench_left");
+    r->set_frame_index(1234);
+    r->set_timestamp_ns(1000000000ULL);
+  }
+  for (int i = 0; i < kDetections; ++i) {
+    const float x = u(rng), y = u(rng), w = 0.05f + 0.2f * u(rng), h = 0.05f + 0.2f * u(rng);
+    const float score = u(rng);
+    const uint32_t cls = (uint32_t)(u(rng) * 80);
+    auto* pk = packed.mutable_packed();
+    pk->add_boxes(x); pk->add_boxes(y); pk->add_boxes(w); pk->add_boxes(h);
+    pk->add_scores(score);
+    pk->add_class_ids(cls);
+    auto* d = nested.add_detections();
+    d->set_class_id(cls);
+    d->set_score(score);
+    d->mutable_box()->set_x(x); d->mutable_box()->set_y(y);
+    d->mutable_box()->set_w(w); d->mutable_box()->set_h(h);
+  }
+}
+
+// Best of kRuns, in ns per result.
+template <class F>
+static double time_ns(F&& f) {
+  double best = 1e30;
+  for (int r = 0; r < kRuns; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIters; ++i) f();
+    const auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / kIters);
+  }
+  return best;
+}
+
+int main() {
+  vision::Result packed, nested;
+  make_results(packed, nested);
+  const std::string packed_wire = packed.SerializeAsString();
+  const std::string nested_wire = nested.SerializeAsString();
+
+  vision::Result res;
+  std::vector<AIV_Detection> a, b;
+  const double packed_ns = time_ns([&] {
+    res.ParseFromString(packed_wire);
+    unpack_detections(res.packed(), kThresh, a);
+  });
+  const double nested_ns = time_ns([&] {
+    res.ParseFromString(nested_wire);
+    copy_detections(res, kThresh, b);
+  });
+
+  vision::Result pres, nres;
+  pres.ParseFromString(packed_wire);
+  nres.ParseFromString(nested_wire);
+  const double packed_conv_ns = time_ns([&] { unpack_detections(pres.packed(), kThresh, a); });
+  const double nested_conv_ns = time_ns([&] { copy_detections(nres, kThresh, b); });
+
+  std::printf("%d detections, score >= %.2f keeps %zu\n", kDetections, kThresh, a.size());
+  std::printf("  packed: %5zu bytes, parse+convert %7.0f ns, convert only %6.0f ns\n",
+              packed_wire.size(), packed_ns, packed_conv_ns);
+  std::printf("  nested: %5zu bytes, parse+convert %7.0f ns, convert only %6.0f ns\n",
+              nested_wire.size(), nested_ns, nested_conv_ns);
+
+  if (a.size() != b.size() || std::memcmp(a.data(), b.data(), a.size() * sizeof(AIV_Detection)) != 0) {
+    std::fprintf(stderr, "packed and nested paths disagree\n");
+    return 1;
+  }
+  return 0;
+}
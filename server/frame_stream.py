@@ -0,0 +1,66 @@
+import asyncio
+import time
+
+# Frames read ahead of the serving loop. Past this the reader stops pulling,
+# so gRPC flow control pushes back on the client again.
+_READ_AHEAD = 64
+
+
+async def _read_ahead(items):
+    # Pull the request stream in its own task so frames are stamped when they
+    # arrive, not when the serial serving loop asks for the next one. Time spent
+    # queued behind the previous frame's inference then counts as server wait
+    # (inference_start_ns - server_recv_ns) instead of uplink.
+    queue = asyncio.Queue(_READ_AHEAD)
+    end = object()
+
+    async def pump():
+        try:
+            async for item in items:
+                await queue.put(item)
+            await queue.put(end)
+        except asyncio.CancelledError:
+            raise
+        except Exception as e:
+            await queue.put(e)
+
+    task = asyncio.create_task(pump())
+    try:
+        while True:
+            item = await queue.get()
+            if item is end:
+                return
+            if isinstance(item, Exception):
+                raise item
+            yield item
+    finally:
+        task.cancel()
+
+
+async def _stamp(frames):
+    async for f in frames:
+        yield f, time.monotonic_ns()
+
+
+async def _unbatch(batches):
+    # Restore stream_id/camera_id from the session's StreamInfo declarations.
+    # Every frame of a batch shares the batch's receive time.
+    streams = {}
+    async for batch in batches:
+        recv_ns = time.monotonic_ns()
+        for si in batch.streams:
+            streams[si.key] = si
+        for f in batch.frames:
+            si = streams.get(f.stream_key)
+            if si is not None:
+                f.stream_id = si.stream_id
+                f.camera_id = si.camera_id
+            yield f, recv_ns
+
+
+def stamped(frames):
+    return _read_ahead(_stamp(frames))
+
+
+def unbatched(batches):
+    return _read_ahead(_unbatch(batches))
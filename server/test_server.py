@@ -7,6 +7,7 @@ from pathlib import Path
 import grpc
 import vision_pb2 as pb
 import vision_pb2_grpc as pb_grpc
+from frame_stream import stamped, unbatched
 
 SAVE_ROOT = Path(os.environ.get("AIV_SAVE_DIR", "./received")).resolve()
 
@@ -16,6 +17,15 @@ def _safe(s: str) -> str:
     return re.sub(r"[^A-Za-z0-9_.-]+", "_", s)[:128] or "unk"
 
 
+def _moving_box(timestamp_ns: int) -> pb.Box:
+    # Box sweeping horizontally at a constant speed, so the client-side
+    # tracker has a known velocity to extrapolate.
+    period_s = float(os.environ.get("AIV_TEST_BOX_PERIOD_S", "4.0"))
+    phase = (timestamp_ns * 1e-9 / period_s) % 2.0
+    cx = 0.2 + 0.6 * (phase if phase <= 1.0 else 2.0 - phase)
+    return pb.Box(x=cx, y=0.5, w=0.2, h=0.3)
+
+
 class TestVisionServicer(pb_grpc.VisionServicer):
     def __init__(self):
         super().__init__()
@@ -29,8 +39,25 @@ class TestVisionServicer(pb_grpc.VisionServicer):
         return pb.DetectResponse(detections=[det])
 
     async def StreamDetect(self, request_iterator, context):
+        async for res in self._serve(stamped(request_iterator)):
+            yield res
+
+    async def StreamDetectBatched(self, request_iterator, context):
+        batches = 0
+
+        async def counted():
+            nonlocal batches
+            async for batch in request_iterator:
+                batches += 1
+                print(f"[recv] batch #{batches}: {len(batch.frames)} frames, {len(batch.streams)} new streams")
+                yield batch
+
+        async for res in self._serve(unbatched(counted())):
+            yield res
+
+    async def _serve(self, frames):
         frame_count = 0
-        async for req in request_iterator:
+        async for req, recv_ns in frames:
             frame_count += 1
             print(
                 f"[recv] #{frame_count} "
@@ -45,7 +72,14 @@ class TestVisionServicer(pb_grpc.VisionServicer):
             d = SAVE_ROOT / sid / cid
             d.mkdir(parents=True, exist_ok=True)
             base = f"img_{int(req.frame_index)}_{int(req.timestamp_ns)}"
-            jpg_path = d / f"{base}.jpg"
+            if req.slice_count > 1:
+                base += f"_s{int(req.slice_index)}"
+            ext = {
+                pb.IMAGE_FORMAT_H264: "h264",
+                pb.IMAGE_FORMAT_GRAY8: "y8",
+                pb.IMAGE_FORMAT_I420: "i420",
+            }.get(req.format, "jpg")
+            jpg_path = d / f"{base}.{ext}"
             meta_path = d / f"{base}.json"
 
             try:
@@ -59,6 +93,10 @@ class TestVisionServicer(pb_grpc.VisionServicer):
                     "width": int(req.width),
                     "height": int(req.height),
                     "format": int(req.format),
+                    "keyframe": bool(req.keyframe),
+                    "slice_index": int(req.slice_index),
+                    "slice_count": int(req.slice_count),
+                    "slice_y": int(req.slice_y),
                     "saved_at": time.time(),
                     "jpeg_path": str(jpg_path),
                 }
@@ -68,10 +106,25 @@ class TestVisionServicer(pb_grpc.VisionServicer):
                 # Do not abort the stream on I/O errors; just report.
                 print(f"[error] failed to save frame #{frame_count}: {e}")
 
-            det = pb.Detection(box=pb.Box(x=0.35, y=0.35, w=0.30, h=0.30), class_id=0, score=0.99)
+            if req.slice_count > 1 and req.slice_index + 1 < req.slice_count:
+                continue  # answer once per frame, after its last slice
+
+            box = _moving_box(req.timestamp_ns)
             res = pb.Result(
+                stream_id=req.stream_id,
                 frame_index=req.frame_index,
                 timestamp_ns=req.timestamp_ns,
-                detections=[det],
+                client_send_ns=req.client_send_ns,
+                config_version=req.config_version,
+                server_recv_ns=recv_ns,
+                inference_start_ns=time.monotonic_ns(),
             )
+            if req.result_encoding == pb.RESULT_ENCODING_PACKED:
+                res.packed.boxes.extend([box.x, box.y, box.w, box.h])
+                res.packed.scores.append(0.99)
+                res.packed.class_ids.append(0)
+            else:
+                res.detections.append(pb.Detection(box=box, class_id=0, score=0.99))
+            res.server_send_ns = time.monotonic_ns()
+            res.processing_ns = res.server_send_ns - recv_ns
             yield res
\ No newline at end of file
@@ -1,5 +1,8 @@
+import asyncio
 import os
+import time
 
+import av
 import grpc
 import numpy as np
 import cv2
@@ -7,34 +10,102 @@ import onnxruntime as ort
 
 import vision_pb2 as pb
 import vision_pb2_grpc as pb_grpc
+from frame_stream import stamped, unbatched
 
 MODEL_PATH = os.getenv("MODEL_PATH", "/app/model.onnx")
 
 
-def _imdecode_rgb(jpeg_bytes: bytes):
+def _imdecode(jpeg_bytes: bytes):
+    # RGB, or 2-D luma for a single-component (grayscale) JPEG.
     arr = np.frombuffer(jpeg_bytes, dtype=np.uint8)
-    img = cv2.imdecode(arr, cv2.IMREAD_COLOR)
+    img = cv2.imdecode(arr, cv2.IMREAD_UNCHANGED)
     if img is None:
         raise RuntimeError("Failed to decode image")
-    img = cv2.cvtColor(img, cv2.COLOR_BGR2RGB)
+    if img.ndim == 2:
+        return img
+    return cv2.cvtColor(img, cv2.COLOR_BGR2RGB)
+
+
+def _decode_raw(req):
+    buf = np.frombuffer(req.data, dtype=np.uint8)
+    h, w = int(req.height), int(req.width)
+    if req.format == pb.IMAGE_FORMAT_GRAY8:
+        if buf.size != h * w:
+            raise RuntimeError(f"GRAY8 payload is {buf.size} bytes, expected {h * w}")
+        return buf.reshape(h, w)
+    if buf.size != h * w * 3 // 2:
+        raise RuntimeError(f"I420 payload is {buf.size} bytes, expected {h * w * 3 // 2}")
+    return cv2.cvtColor(buf.reshape(h * 3 // 2, w), cv2.COLOR_YUV2RGB_I420)
+
+
+def _match_channels(img: np.ndarray, channels: int):
+    if channels == 1 and img.ndim == 3:
+        return cv2.cvtColor(img, cv2.COLOR_RGB2GRAY)
+    if channels == 3 and img.ndim == 2:
+        return cv2.cvtColor(img, cv2.COLOR_GRAY2RGB)
     return img
 
 
-def _preprocess(img_rgb: np.ndarray, size=(640, 640)):
-    h0, w0 = img_rgb.shape[:2]
-    img = cv2.resize(img_rgb, size, interpolation=cv2.INTER_LINEAR)
+def _preprocess(img: np.ndarray, size=(640, 640)):
+    h0, w0 = img.shape[:2]
+    img = cv2.resize(img, size, interpolation=cv2.INTER_LINEAR)
+    if img.ndim == 2:
+        img = img[..., None]
     x = (img.astype(np.float32) / 255.0).transpose(2, 0, 1)[None, ...].copy()
     orig = np.array([[h0, w0]], dtype=np.int64)
     return x, orig, (h0, w0)
 
 
-def _to_center_xywh(xyxy: np.ndarray):
-    x1, y1, x2, y2 = xyxy
-    w = max(0.0, x2 - x1)
-    h = max(0.0, y2 - y1)
-    cx = x1 + w * 0.5
-    cy = y1 + h * 0.5
-    return np.array([cx, cy, w, h], dtype=np.float32)
+class _SliceAssembler:
+    """Rebuilds sliced frames, decoding each band as soon as it arrives."""
+
+    def __init__(self):
+        self._frames = {}  # stream_id -> [frame_index, image, bands received]
+
+    def add(self, req):
+        cur = self._frames.get(req.stream_id)
+        if cur is not None and req.frame_index < cur[0]:
+            return None  # late band of a frame already superseded
+        band = _imdecode(req.data)
+        if cur is None or cur[0] != req.frame_index:
+            # A newer frame replaces an incomplete one (its bands were dropped).
+            shape = (req.height, req.width) + band.shape[2:]
+            cur = [req.frame_index, np.zeros(shape, dtype=np.uint8), 0]
+            self._frames[req.stream_id] = cur
+
+        y = int(req.slice_y)
+        h = min(band.shape[0], int(req.height) - y)
+        w = min(band.shape[1], int(req.width))
+        cur[1][y:y + h, :w] = band[:h, :w]
+        cur[2] += 1
+        if cur[2] < req.slice_count:
+            return None
+        del self._frames[req.stream_id]
+        return cur[1]
+
+
+class _VideoDecoders:
+    """One H.264 decoder per stream; after an error, waits for the next IDR."""
+
+    def __init__(self):
+        self._ctx = {}
+
+    def decode(self, req):
+        ctx = self._ctx.get(req.stream_id)
+        if ctx is None:
+            if not req.keyframe:
+                return None
+            ctx = av.CodecContext.create("h264", "r")
+            ctx.thread_type = "SLICE"  # frame threading would add decode delay
+            self._ctx[req.stream_id] = ctx
+        try:
+            frames = ctx.decode(av.Packet(req.data))
+        except av.error.FFmpegError:
+            del self._ctx[req.stream_id]
+            raise
+        if not frames:
+            return None
+        return frames[-1].to_ndarray(format="rgb24")
 
 
 class VisionServicer(pb_grpc.VisionServicer):
@@ -45,6 +116,10 @@ class VisionServicer(pb_grpc.VisionServicer):
 
         self.in_images = "images"
         self.in_orig = "orig_target_sizes"
+        # [N, C, H, W]; frames are converted to the model's channel count, so
+        # grayscale frames feed single-channel models without a colour round trip.
+        shape = next(i.shape for i in self.session.get_inputs() if i.name == self.in_images)
+        self.in_channels = shape[1] if isinstance(shape[1], int) else 3
 
         self.out_labels = "labels"
         self.out_boxes = "boxes"
@@ -53,11 +128,13 @@ class VisionServicer(pb_grpc.VisionServicer):
         print("Vision server ready on :8032 (ONNX Runtime)")
 
     def _run_onnx(self, img_bytes: bytes):
-        img = _imdecode_rgb(img_bytes)
-        x, orig, (h0, w0) = _preprocess(img, (640, 640))
+        return self._infer(_imdecode(img_bytes))
+
+    def _infer(self, img: np.ndarray):
+        x, orig, (h0, w0) = _preprocess(_match_channels(img, self.in_channels), (640, 640))
 
         feeds = {
-            self.in_images: x,                # float32 [1,3,640,640]
+            self.in_images: x,                # float32 [1,C,640,640]
             self.in_orig: orig               # int64   [1,2] (h,w)
         }
         outs = self.session.run([self.out_labels, self.out_boxes, self.out_scores], feeds)
@@ -92,7 +169,7 @@ class VisionServicer(pb_grpc.VisionServicer):
 
         keep = np.where(conf >= conf_th)[0]
         if keep.size == 0:
-            return []
+            return None
 
         conf = conf[keep]
         boxes = boxes[keep]
@@ -112,18 +189,45 @@ class VisionServicer(pb_grpc.VisionServicer):
             abs_boxes = boxes.astype(np.float32)
 
         xyxy_like = np.mean(abs_boxes[:, 2] > abs_boxes[:, 0]) > 0.8 and np.mean(abs_boxes[:, 3] > abs_boxes[:, 1]) > 0.8
-        out = []
-        for b, s, c in zip(abs_boxes, conf, cls_ids):
-            if xyxy_like:
-                cx, cy, w, h = _to_center_xywh(b)
-            else:
-                cx, cy, w, h = b
-            x = float(np.clip(cx / max(w0, 1), 0.0, 1.0))
-            y = float(np.clip(cy / max(h0, 1), 0.0, 1.0))
-            wn = float(np.clip(w / max(w0, 1), 0.0, 1.0))
-            hn = float(np.clip(h / max(h0, 1), 0.0, 1.0))
-            out.append(pb.Detection(box=pb.Box(x=x, y=y, w=wn, h=hn), class_id=int(c), score=float(s)))
-        return out
+        if xyxy_like:
+            wh = np.maximum(abs_boxes[:, 2:4] - abs_boxes[:, 0:2], 0.0)
+            cxcywh = np.concatenate([abs_boxes[:, 0:2] + wh * 0.5, wh], axis=1)
+        else:
+            cxcywh = abs_boxes
+        scale = np.array([max(w0, 1), max(h0, 1), max(w0, 1), max(h0, 1)], dtype=np.float32)
+        norm = np.clip(cxcywh / scale, 0.0, 1.0).astype(np.float32)
+        return norm, conf.astype(np.float32), cls_ids
+
+    def _make_result(self, req, dets, recv_ns=0, infer_ns=0):
+        res = pb.Result(
+            stream_id=req.stream_id,
+            frame_index=req.frame_index,
+            timestamp_ns=req.timestamp_ns,
+            client_send_ns=req.client_send_ns,
+            config_version=req.config_version,
+            server_recv_ns=recv_ns,
+            inference_start_ns=infer_ns,
+        )
+        if dets is not None:
+            self._fill_detections(res, req, dets)
+        if recv_ns:
+            res.server_send_ns = time.monotonic_ns()
+            res.processing_ns = res.server_send_ns - recv_ns
+        return res
+
+    @staticmethod
+    def _fill_detections(res, req, dets):
+        boxes, scores, cls_ids = dets
+        if req.result_encoding == pb.RESULT_ENCODING_PACKED:
+            res.packed.boxes.extend(boxes.ravel().tolist())
+            res.packed.scores.extend(scores.tolist())
+            res.packed.class_ids.extend(cls_ids.astype(np.uint32).tolist())
+        else:
+            res.detections.extend(
+                pb.Detection(box=pb.Box(x=float(b[0]), y=float(b[1]), w=float(b[2]), h=float(b[3])),
+                             class_id=int(c), score=float(s))
+                for b, s, c in zip(boxes, scores, cls_ids)
+            )
 
     async def Detect(self, request, context):
         if not request.width or not request.height:
@@ -131,28 +235,43 @@ class VisionServicer(pb_grpc.VisionServicer):
         if not request.data:
             await context.abort(grpc.StatusCode.INVALID_ARGUMENT, "image data required")
         try:
-            dets = self._run_onnx(request.data)
-            return pb.DetectResponse(detections=dets)
+            res = self._make_result(request, self._run_onnx(request.data))
+            return pb.DetectResponse(detections=res.detections)
         except Exception as e:
             await context.abort(grpc.StatusCode.INTERNAL, f"inference failed: {e}")
 
     async def StreamDetect(self, request_iterator, context):
+        async for res in self._serve(stamped(request_iterator)):
+            yield res
+
+    async def StreamDetectBatched(self, request_iterator, context):
+        async for res in self._serve(unbatched(request_iterator)):
+            yield res
+
+    async def _serve(self, frames):
         frame_count = 0
-        async for req in request_iterator:
-            frame_count += 1
+        slices = _SliceAssembler()
+        video = _VideoDecoders()
+        async for req, recv_ns in frames:
+            infer_ns = 0
             try:
-                dets = self._run_onnx(req.data)
-                res = pb.Result(
-                    stream_id=req.stream_id,
-                    frame_index=req.frame_index,
-                    timestamp_ns=req.timestamp_ns,
-                    detections=dets,
-                )
-                yield res
+                if req.format == pb.IMAGE_FORMAT_H264:
+                    img = video.decode(req)
+                    if img is None:
+                        raise RuntimeError("no picture (waiting for keyframe)")
+                elif req.format in (pb.IMAGE_FORMAT_GRAY8, pb.IMAGE_FORMAT_I420):
+                    img = _decode_raw(req)
+                elif req.slice_count > 1:
+                    img = slices.add(req)
+                    if img is None:
+                        continue
+                else:
+                    img = _imdecode(req.data)
+                frame_count += 1
+                infer_ns = time.monotonic_ns()
+                # Off the event loop, so the reader task keeps stamping arrivals.
+                dets = await asyncio.to_thread(self._infer, img)
             except Exception as e:
                 print(f"[error] inference failed at frame #{frame_count}: {e}")
-                yield pb.Result(
-                    frame_index=req.frame_index,
-                    timestamp_ns=req.timestamp_ns,
-                    detections=[],
-                )
+                dets = None
+            yield self._make_result(req, dets, recv_ns, infer_ns)
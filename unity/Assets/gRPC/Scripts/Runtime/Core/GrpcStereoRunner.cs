@@ -32,18 +32,36 @@ namespace Grpc
         [SerializeField] private int leftWidth = 640;
         [SerializeField] private int leftHeight = 480;
         [SerializeField] private int leftFps = 30;
+        [SerializeField] private float leftSendFps = 0f;  // 0 = every captured frame
+        [SerializeField] private int leftPriority = 1;
+        [SerializeField] private DropPolicy leftDropPolicy = DropPolicy.DROP_OLDEST;
 
         [Header("Right Camera")]
         [SerializeField] private bool enableRightCamStreaming = true;
         [SerializeField] private int rightWidth = 640;
         [SerializeField] private int rightHeight = 480;
         [SerializeField] private int rightFps = 30;
+        [SerializeField] private float rightSendFps = 0f;  // 0 = every captured frame
+        [SerializeField] private int rightPriority = 1;
+        [SerializeField] private DropPolicy rightDropPolicy = DropPolicy.DROP_OLDEST;
 
         [Header("Runtime Tuning")]
         [SerializeField] private float scoreThreshold = 0.0f;
+        [SerializeField] private DispatchMode dispatchMode = DispatchMode.LATEST;
+        [SerializeField] private ConnectionMode connectionMode = ConnectionMode.SHARED;
+        [SerializeField] private bool pollResults = false; // read results in Update instead of the callback
         [SerializeField] private int jpegWidth = 0;      // 0 = capture size
         [SerializeField] private int jpegHeight = 0;     // 0 = capture size
         [SerializeField] private int jpegQuality = 70;   // 1..100
+        [SerializeField] private bool packedResults = false;
+        [SerializeField] private int sliceCount = 1;     // 1 = whole frame
+        [SerializeField] private VideoCodec videoCodec = VideoCodec.JPEG;
+        [SerializeField] private ColorMode colorMode = ColorMode.YUV; // GRAY for single-channel models
+        [SerializeField] private int videoBitrateKbps = 2000;
+        [SerializeField] private int keyframeInterval = 30;
+        [SerializeField] private int batchMaxFrames = 1;      // 1 = no batching
+        [SerializeField] private int batchMaxBytes = 256 * 1024;
+        [SerializeField] private int batchMaxDelayUs = 5000;
 
         public CameraParams? LeftCameraParams { get; set; } = null;
         public CameraParams? RightCameraParams { get; set; } = null;
@@ -52,22 +70,14 @@ namespace Grpc
 
         private void Start()
         {
+            // Before Init, so every connection the mode needs is opened up front.
+            Native.SetConnectionMode(connectionMode);
             var st = Native.Init($"{host}:{port}");
             Debug.Log($"Init: {st}");
             if (st != AivStatus.OK) return;
 
             Native.SetCallbacks(
-                onResult: r =>
-                {
-                    Debug.Log($"Result: id={r.ImageId} det={r.Detections.Length}, ts={r.TimestampSec}, recv-ts={r.ReceivedTimeSec}");
-                    for (int i = 0; i < r.Detections.Length; ++i)
-                    {
-                        var d = r.Detections[i];
-                        Debug.Log($"  [{i}] box=({d.Box.x},{d.Box.y},{d.Box.w},{d.Box.h}) cls={d.ClassId} score={d.Score}");
-                    }
-
-                    ResultReceived?.Invoke(r, GetCameraParamsByStreamId(r.ImageId, baseStreamId));
-                },
+                onResult: pollResults ? null : OnResult,
                 onError: (code, msg) =>
                 {
                     Debug.LogError($"Error {code}: {msg}");
@@ -78,15 +88,33 @@ namespace Grpc
                 }
             );
 
-            Native.SetScoreThreshold(scoreThreshold);
+            Native.SetDispatchMode(dispatchMode);
+
+            var enc = packedResults ? ResultEncoding.PACKED : ResultEncoding.DETECTIONS;
+            Native.SetResultEncoding(CamRole.LEFT, enc);
+            Native.SetResultEncoding(CamRole.RIGHT, enc);
+
+            ApplyLiveConfig();
+            Native.SetSliceCount(Mathf.Clamp(sliceCount, 1, 16));
 
-            var jc = new JpegConfig
+            var vc = new VideoConfig
             {
-                jpeg_width = jpegWidth,
-                jpeg_height = jpegHeight,
-                jpeg_quality = Mathf.Clamp(jpegQuality, 1, 100)
+                codec = (int)videoCodec,
+                bitrate_kbps = videoBitrateKbps,
+                keyframe_interval = keyframeInterval
             };
-            Native.SetJpegConfig(jc);
+            var vst = Native.SetVideoConfig(vc);
+            if (vst != AivStatus.OK) Debug.LogError($"SetVideoConfig failed: {vst}");
+            Native.SetColorMode(colorMode);
+
+            var bc = new BatchConfig
+            {
+                max_frames = Mathf.Max(1, batchMaxFrames),
+                max_bytes = batchMaxBytes,
+                max_delay_us = batchMaxDelayUs
+            };
+            var bst = Native.SetBatchConfig(bc);
+            if (bst != AivStatus.OK) Debug.LogError($"SetBatchConfig failed: {bst}");
 
             var est = Native.EnumerateCameras(out var camJson);
             Debug.Log($"Enumerate: {est} json={camJson}");
@@ -94,6 +122,59 @@ namespace Grpc
             if (autoStart) StartSending();
         }
 
+        // Quality, output size, threshold and send rates take effect on the next frame.
+        public void ApplyLiveConfig()
+        {
+            var lc = new LiveConfig
+            {
+                jpeg = new JpegConfig
+                {
+                    jpeg_width = jpegWidth,
+                    jpeg_height = jpegHeight,
+                    jpeg_quality = Mathf.Clamp(jpegQuality, 1, 100)
+                },
+                score_threshold = scoreThreshold,
+                stream_left = new StreamPolicy
+                {
+                    max_fps = leftSendFps,
+                    priority = Mathf.Max(1, leftPriority),
+                    drop_policy = (int)leftDropPolicy
+                },
+                stream_right = new StreamPolicy
+                {
+                    max_fps = rightSendFps,
+                    priority = Mathf.Max(1, rightPriority),
+                    drop_policy = (int)rightDropPolicy
+                }
+            };
+            var st = Native.SetLiveConfig(lc);
+            if (st != AivStatus.OK) Debug.LogError($"SetLiveConfig failed: {st}");
+        }
+
+        private void OnValidate()
+        {
+            if (Application.isPlaying && Native.IsStreaming()) ApplyLiveConfig();
+        }
+
+        private void Update()
+        {
+            if (!pollResults) return;
+            if (Native.PollLatestResult(CamRole.LEFT, out var left)) OnResult(left);
+            if (Native.PollLatestResult(CamRole.RIGHT, out var right)) OnResult(right);
+        }
+
+        private void OnResult(Result r)
+        {
+            Debug.Log($"Result: id={r.ImageId} det={r.Detections.Length}, ts={r.TimestampSec}, recv-ts={r.ReceivedTimeSec}");
+            for (int i = 0; i < r.Detections.Length; ++i)
+            {
+                var d = r.Detections[i];
+                Debug.Log($"  [{i}] box=({d.Box.x},{d.Box.y},{d.Box.w},{d.Box.h}) cls={d.ClassId} score={d.Score}");
+            }
+
+            ResultReceived?.Invoke(r, GetCameraParamsByStreamId(r.ImageId, baseStreamId));
+        }
+
         public void StartSending()
         {
             if (Native.IsStreaming()) return;
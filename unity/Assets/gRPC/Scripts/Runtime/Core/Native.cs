@@ -17,6 +17,7 @@ namespace Grpc
         ERR_CAMERA_OPEN = -5,
         ERR_CAMERA_PARAM = -6,
         ERR_GRPC = -7,
+        ERR_IO = -8,
         ERR_INTERNAL = -9
     }
 
@@ -26,6 +27,60 @@ namespace Grpc
         RIGHT = 1
     }
 
+    public enum DropPolicy : int
+    {
+        DROP_OLDEST = 0,
+        DROP_NEWEST = 1
+    }
+
+    public enum ResultEncoding : int
+    {
+        DETECTIONS = 0,
+        PACKED = 1
+    }
+
+    public enum DispatchMode : int
+    {
+        INLINE = 0,
+        LATEST = 1,
+        QUEUE = 2
+    }
+
+    public enum ConnectionMode : int
+    {
+        SHARED = 0,
+        PER_STREAM = 1
+    }
+
+    public enum VideoCodec : int
+    {
+        JPEG = 0,
+        H264 = 1,
+        RAW = 2
+    }
+
+    public enum ColorMode : int
+    {
+        YUV = 0,
+        GRAY = 1
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct VideoConfig
+    {
+        public int codec;
+        public int bitrate_kbps;
+        public int keyframe_interval;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct BatchConfig
+    {
+        public int max_frames;
+        public int max_bytes;
+        public int max_delay_us;
+    }
+
     [StructLayout(LayoutKind.Sequential, Pack = 8)]
     public struct Intrinsics
     {
@@ -62,6 +117,14 @@ namespace Grpc
         public int fps;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct StreamPolicy
+    {
+        public float max_fps;
+        public int priority;
+        public int drop_policy;
+    }
+
     [StructLayout(LayoutKind.Sequential, Pack = 8)]
     public struct Box
     {
@@ -94,6 +157,43 @@ namespace Grpc
         public double timestamp_sec;
         public IntPtr detections;
         public int detection_count;
+        public FrameLatency latency;
+        public uint config_version;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FrameLatency
+    {
+        public long capture_to_send_ns;
+        public long uplink_ns;
+        public long server_wait_ns;
+        public long server_processing_ns;
+        public long downlink_ns;
+        public long total_ns;
+        public int valid;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ClockSync
+    {
+        public long offset_ns;
+        public double drift_ppm;
+        public long min_rtt_ns;
+        public int samples;
+    }
+
+    // ns since StartStreamingStereo/StartReplay; 0 = not reached yet.
+    [StructLayout(LayoutKind.Sequential)]
+    public struct StartupStats
+    {
+        public long channel_ready_ns;
+        public long stream_open_ns;
+        public long camera_open_left_ns;
+        public long camera_open_right_ns;
+        public long encoder_ready_ns;
+        public long first_frame_ns;
+        public long first_send_ns;
+        public long first_result_ns;
     }
 
     public struct Result
@@ -103,6 +203,8 @@ namespace Grpc
         public double TimestampSec;
         public double ReceivedTimeSec;
         public Detection[] Detections;
+        public FrameLatency Latency;
+        public uint ConfigVersion;
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -113,6 +215,33 @@ namespace Grpc
         public int jpeg_quality;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct LiveConfig
+    {
+        public JpegConfig jpeg;
+        public float score_threshold;
+        public StreamPolicy stream_left;
+        public StreamPolicy stream_right;
+        public uint version;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TrackerConfig
+    {
+        public float iou_threshold;
+        public float velocity_smoothing;
+        public long max_age_ns;
+        public long max_predict_ns;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ReplayConfig
+    {
+        public int max_speed;
+        public long start_frame;
+        public long end_frame;
+    }
+
     public static class Native
     {
         private const string LIB = "aiv_plugin";
@@ -125,6 +254,8 @@ namespace Grpc
         private static Action<int, string> s_onErrorManaged;
         private static Action<string, long, double> s_onFrameSentManaged;
 
+        private static readonly NativeDetection[] s_pollDets = new NativeDetection[256];
+
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
         private delegate void OnResultCb(IntPtr resultPtr);
 
@@ -143,12 +274,33 @@ namespace Grpc
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern void AIV_SetCallbacks(OnResultCb on_result, OnErrorCb on_error, OnFrameSentCb on_frame_sent);
 
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetLiveConfig(ref LiveConfig cfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void AIV_GetLiveConfig(out LiveConfig outCfg);
+
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern AivStatus AIV_SetJpegConfig(ref JpegConfig cfg);
 
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern void AIV_GetJpegConfig(out JpegConfig outCfg);
 
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetVideoConfig(ref VideoConfig cfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void AIV_GetVideoConfig(out VideoConfig outCfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetSliceCount(int slices);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetBatchConfig(ref BatchConfig cfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void AIV_GetBatchConfig(out BatchConfig outCfg);
+
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
         private static extern AivStatus AIV_EnumerateCameras(StringBuilder out_json, int capacity);
 
@@ -161,6 +313,24 @@ namespace Grpc
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern AivStatus AIV_SetScoreThreshold(float score_threshold);
 
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetResultEncoding(int role, int encoding);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetStreamPolicy(int role, ref StreamPolicy policy);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_GetStreamPolicy(int role, out StreamPolicy outPolicy);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetTrackerConfig(ref TrackerConfig cfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void AIV_GetTrackerConfig(out TrackerConfig outCfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_GetPredictedDetections(int role, long target_time_ns, [Out] NativeDetection[] out_dets, int capacity, out int out_count);
+
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
         private static extern AivStatus AIV_SetStereoStreamBaseId(string base_id);
 
@@ -175,6 +345,45 @@ namespace Grpc
 
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern int AIV_IsStreaming();
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        private static extern AivStatus AIV_StartRecording(string path);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_StopRecording();
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int AIV_IsRecording();
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        private static extern AivStatus AIV_StartReplay(string path, ref ReplayConfig cfg);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int AIV_IsReplaying();
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_GetClockSync(out ClockSync outSync);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_GetStartupStats(out StartupStats outStats);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetDispatchMode(int mode);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetConnectionMode(int mode);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int AIV_GetConnectionMode();
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern AivStatus AIV_SetColorMode(int mode);
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int AIV_GetColorMode();
+
+        [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int AIV_PollLatestResult(int role, out NativeResult outResult, [Out] NativeDetection[] dets, int capacity);
+
         [DllImport(LIB, CallingConvention = CallingConvention.Cdecl)]
         private static extern long AIV_GetElapsedRealtimeNanos();
 
@@ -195,6 +404,14 @@ namespace Grpc
             AIV_SetCallbacks(s_onResultCb, s_onErrorCb, s_onFrameSentCb);
         }
 
+        public static AivStatus SetLiveConfig(LiveConfig cfg) => AIV_SetLiveConfig(ref cfg);
+
+        public static LiveConfig GetLiveConfig()
+        {
+            AIV_GetLiveConfig(out var c);
+            return c;
+        }
+
         public static AivStatus SetJpegConfig(JpegConfig cfg) => AIV_SetJpegConfig(ref cfg);
 
         public static JpegConfig GetJpegConfig()
@@ -203,6 +420,24 @@ namespace Grpc
             return c;
         }
 
+        public static AivStatus SetVideoConfig(VideoConfig cfg) => AIV_SetVideoConfig(ref cfg);
+
+        public static VideoConfig GetVideoConfig()
+        {
+            AIV_GetVideoConfig(out var c);
+            return c;
+        }
+
+        public static AivStatus SetSliceCount(int slices) => AIV_SetSliceCount(slices);
+
+        public static AivStatus SetBatchConfig(BatchConfig cfg) => AIV_SetBatchConfig(ref cfg);
+
+        public static BatchConfig GetBatchConfig()
+        {
+            AIV_GetBatchConfig(out var c);
+            return c;
+        }
+
         public static AivStatus EnumerateCameras(out string json)
         {
             var sb = new StringBuilder(4096);
@@ -224,6 +459,42 @@ namespace Grpc
 
         public static AivStatus SetScoreThreshold(float v) => AIV_SetScoreThreshold(v);
 
+        public static AivStatus SetResultEncoding(CamRole role, ResultEncoding encoding) =>
+            AIV_SetResultEncoding((int)role, (int)encoding);
+
+        public static AivStatus SetStreamPolicy(CamRole role, StreamPolicy policy) =>
+            AIV_SetStreamPolicy((int)role, ref policy);
+
+        public static AivStatus GetStreamPolicy(CamRole role, out StreamPolicy policy) =>
+            AIV_GetStreamPolicy((int)role, out policy);
+
+        public static AivStatus SetTrackerConfig(TrackerConfig cfg) => AIV_SetTrackerConfig(ref cfg);
+
+        public static TrackerConfig GetTrackerConfig()
+        {
+            AIV_GetTrackerConfig(out var c);
+            return c;
+        }
+
+        public static AivStatus GetPredictedDetections(CamRole role, long targetTimeNs, int capacity, out Detection[] detections)
+        {
+            var buf = new NativeDetection[Math.Max(0, capacity)];
+            var st = AIV_GetPredictedDetections((int)role, targetTimeNs, buf, buf.Length, out var count);
+            if (st != AivStatus.OK) count = 0;
+
+            detections = new Detection[count];
+            for (int i = 0; i < count; ++i)
+            {
+                detections[i] = new Detection
+                {
+                    Box = buf[i].box,
+                    ClassId = buf[i].class_id,
+                    Score = buf[i].score
+                };
+            }
+            return st;
+        }
+
         public static AivStatus SetStereoStreamBaseId(string baseId) => AIV_SetStereoStreamBaseId(baseId);
 
         public static AivStatus SetCameraForRole(CamRole role, string camId, CaptureConfig cfg) =>
@@ -235,6 +506,62 @@ namespace Grpc
 
         public static bool IsStreaming() => AIV_IsStreaming() != 0;
 
+        public static AivStatus StartRecording(string path) => AIV_StartRecording(path);
+
+        public static AivStatus StopRecording() => AIV_StopRecording();
+
+        public static bool IsRecording() => AIV_IsRecording() != 0;
+
+        public static AivStatus StartReplay(string path, ReplayConfig cfg) => AIV_StartReplay(path, ref cfg);
+
+        public static bool IsReplaying() => AIV_IsReplaying() != 0;
+
+        public static AivStatus GetClockSync(out ClockSync sync) => AIV_GetClockSync(out sync);
+
+        public static AivStatus GetStartupStats(out StartupStats stats) => AIV_GetStartupStats(out stats);
+
+        public static AivStatus SetDispatchMode(DispatchMode mode) => AIV_SetDispatchMode((int)mode);
+
+        // PER_STREAM: one connection per camera; callbacks may then run on two threads.
+        public static AivStatus SetConnectionMode(ConnectionMode mode) => AIV_SetConnectionMode((int)mode);
+
+        public static ConnectionMode GetConnectionMode() => (ConnectionMode)AIV_GetConnectionMode();
+
+        // GRAY: luma only, for models that do not use colour.
+        public static AivStatus SetColorMode(ColorMode mode) => AIV_SetColorMode((int)mode);
+
+        public static ColorMode GetColorMode() => (ColorMode)AIV_GetColorMode();
+
+        // Main-thread alternative to the result callback; false if nothing new since the last poll.
+        public static bool PollLatestResult(CamRole role, out Result result)
+        {
+            result = default;
+            if (AIV_PollLatestResult((int)role, out var nr, s_pollDets, s_pollDets.Length) == 0) return false;
+
+            var dets = new Detection[Math.Max(0, nr.detection_count)];
+            for (int i = 0; i < dets.Length; ++i)
+            {
+                dets[i] = new Detection
+                {
+                    Box = s_pollDets[i].box,
+                    ClassId = s_pollDets[i].class_id,
+                    Score = s_pollDets[i].score
+                };
+            }
+
+            result = new Result
+            {
+                ImageId = PtrToStringUTF8(nr.image_id),
+                FrameIndex = nr.frame_index,
+                TimestampSec = nr.timestamp_sec,
+                ReceivedTimeSec = GetElapsedRealtimeNanos() / 1e9,
+                Detections = dets,
+                Latency = nr.latency,
+                ConfigVersion = nr.config_version
+            };
+            return true;
+        }
+
         public static long GetElapsedRealtimeNanos() => AIV_GetElapsedRealtimeNanos();
 
         [Preserve]
@@ -272,7 +599,9 @@ namespace Grpc
                 FrameIndex = nr.frame_index,
                 TimestampSec = nr.timestamp_sec,
                 ReceivedTimeSec = receivedTimeSec,
-                Detections = dets
+                Detections = dets,
+                Latency = nr.latency,
+                ConfigVersion = nr.config_version
             };
             s_onResultManaged?.Invoke(r);
         }